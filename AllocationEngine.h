@@ -0,0 +1,109 @@
+#ifndef ALLOCATIONENGINE_H
+#define ALLOCATIONENGINE_H
+
+#include "Zone.h"
+#include "ChunkedArray.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+const int MAX_CANDIDATES = 32;      // zones kept per route list, past the direct neighbours
+const int FAR_HOPS = 255;           // unreachable, or beyond the route list
+const int WAITING_PRIORITY = 100;   // min-penalty mode: cost that puts new requests behind waiters
+
+enum BatchMode {
+    BATCH_IN_ORDER,         // as if each request were submitted in turn
+    BATCH_MIN_PENALTY       // least total penalty over the batch and the waiting queue
+};
+
+struct BatchRequest {
+    int vehicleID;
+    int zone;
+};
+
+struct BatchResult {
+    bool allocated;
+    int zone, area, slot;
+    float penalty;
+};
+
+// Hands out slots nearest zone first. buildRoutes() runs a breadth-first
+// search over the adjacency graph from every zone and keeps, in hop order,
+// the zone itself, all its neighbours and then the closest other zones,
+// each with its hop count; the penalty comes from that distance. A request
+// whose route list is all full falls back to any zone with free capacity,
+// found through a per-zone bitmap rather than a scan of every zone.
+// Zones marked as filling (by the occupancy forecast) are tried after the
+// other zones at the same distance, so the penalty never changes.
+class AllocationEngine {
+private:
+    std::vector<int> routeStart;        // zone -> first entry of its route list
+    std::vector<int> routeZone;
+    std::vector<uint8_t> routeHops;
+    std::vector<std::atomic<uint64_t>> zoneFree;    // bit z set = zone z may have a free slot
+    std::vector<std::atomic<uint64_t>> zoneFilling; // bit z set = zone z expected to fill soon
+    std::atomic<int> fillingCount;
+    int routedZones;                    // -1 until built or after a topology change
+    
+    void syncZoneBit(ChunkedArray<Zone>& zones, int z);
+    bool isFilling(int z);
+    bool claimIn(ChunkedArray<Zone>& zones, int z, int vID, int hops, int& allocArea, 
+                 int& allocSlot, float& penalty, int needs = 0);
+    void claimPlanned(const std::vector<BatchRequest>& batch, std::vector<BatchResult>& results,
+                      ChunkedArray<Zone>& zones, int zoneCount);
+    
+public:
+    AllocationEngine();
+    
+    // Not thread-safe: build before allocating from several threads
+    void buildRoutes(ChunkedArray<Zone>& zones, int zoneCount);
+    void invalidateRoutes();
+    
+    // Thread-safe once routes are built. needs holds the SlotAttribute
+    // flags of the vehicle; only slots it fits are handed out, and zones
+    // with none are passed over on their per-class counters.
+    bool allocate(int reqZone, int vID, int& allocZone, int& allocArea, 
+                  int& allocSlot, float& penalty, ChunkedArray<Zone>& zones, int zoneCount,
+                  int needs = 0);
+    bool release(ChunkedArray<Zone>& zones, int zone, int area, int slot);
+    
+    // Steering; cleared whenever routes are rebuilt
+    void setFilling(int zone, bool filling);
+    int getFillingCount();
+    
+    // Called as the plan puts a request in zone, planned being how many
+    // of the batch it holds so far, so filling marks can be redone before
+    // the next request is planned
+    typedef void (*PlanHook)(void* context, int zone, int planned);
+    
+    // Allocates a burst in one call, with the same outcome as calling
+    // allocate() for each request in order. Zones are chosen first against
+    // free-slot counts alone; then each zone hands over all its slots for
+    // the batch in one bulk claim. Requests a racing thread beat to a slot
+    // fall back to allocate(). Batch vehicles have no requirements.
+    // Without a hook, the filling marks stay as they were at the start.
+    void allocateBatch(const std::vector<BatchRequest>& batch, std::vector<BatchResult>& results,
+                       ChunkedArray<Zone>& zones, int zoneCount,
+                       PlanHook hook = nullptr, void* context = nullptr);
+    
+    // Allocates a batch for the least total penalty rather than first fit
+    // in arrival order, solved as a min-cost flow from requested zones to
+    // zones with free slots. As many requests are placed as there are
+    // slots. The first `waiting` requests are vehicles already in line;
+    // when slots run short they are placed before the others. Filling
+    // marks are not looked at.
+    void allocateMinPenalty(const std::vector<BatchRequest>& batch, int waiting,
+                            std::vector<BatchResult>& results,
+                            ChunkedArray<Zone>& zones, int zoneCount);
+    
+    static float penaltyFor(int hops);
+    
+    // Route list of zone z, nearest first, for callers that claim slots
+    // themselves (ShardedParkingSystem). Entries getRouteStart(z) up to
+    // getRouteStart(z + 1).
+    int getRouteStart(int z) { return routeStart[z]; }
+    int getRouteZone(int k) { return routeZone[k]; }
+    int getRouteHops(int k) { return routeHops[k]; }
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "AllocationEngine.h"
+#include "ChunkedArray.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Micro-benchmarks for the allocation hot path. Each case sweeps zone
+// count, area size, occupancy and adjacency fan-out and writes one CSV
+// row: case,zones,area_slots,occupancy,fanout,ops,ns_per_op,
+// allocs_per_op,p50_ns,p99_ns. Latency percentiles come from timing
+// every operation, with the measured clock overhead subtracted.
+// Rollback, write-ahead log and batch cases put their batch or group
+// size in the fanout column, sharded and pipeline cases their thread
+// count, hold timer cases the timers already pending.
+class Benchmark {
+private:
+    struct Sample {
+        long ops;
+        double totalNs;
+        long allocations;
+        std::vector<float> latencies;
+        
+        Sample() : ops(0), totalNs(0), allocations(0) {}
+    };
+    
+    FILE* out;
+    int opsPerCase;
+    unsigned rng;
+    
+    int nextRandom(int bound);
+    void buildCity(ChunkedArray<Zone>& zones, int zoneCount, int areaSlots,
+                   int occupancy, int fanout);
+    void report(const char* name, int zoneCount, int areaSlots, int occupancy,
+                int fanout, Sample& sample);
+    
+    void benchAllocate(int zoneCount, int areaSlots, int occupancy, int fanout);
+    void benchFindSlot(int zoneCount, int areaSlots, int occupancy);
+    void benchRelease(int zoneCount, int areaSlots, int occupancy);
+    void benchRollback(int batch);
+    void benchBurst(int zoneCount, int areaSlots, int burst, bool batched);
+    void benchMinPenalty(int zoneCount, int occupancy, int batchSize);
+    void benchLogAppend(int group);
+    void benchRecovery(int frames);
+    void benchTimeStamp();
+    void benchSharded(int zoneCount, int shards);
+    void benchPipeline(int producers);
+    void benchHoldTimers(int pending);
+    void benchForecast(int zoneCount);
+    
+public:
+    Benchmark(FILE* outStream, int ops = 200000);
+    
+    void runAll();
+};
+
+#endif
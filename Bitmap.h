@@ -0,0 +1,54 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+// Bit helpers for the occupancy bitmaps in ParkingArea and Zone.
+// A set bit always means "free".
+
+const int BITS_PER_WORD = 64;
+
+inline int wordsFor(int bits) {
+    return (bits + BITS_PER_WORD - 1) / BITS_PER_WORD;
+}
+
+// Index of the lowest set bit. word must be non-zero.
+inline int lowestSetBit(uint64_t word) {
+    #ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return (int)index;
+    #else
+        return __builtin_ctzll(word);
+    #endif
+}
+
+// Index of the highest set bit. word must be non-zero.
+inline int highestSetBit(uint64_t word) {
+    #ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, word);
+        return (int)index;
+    #else
+        return 63 - __builtin_clzll(word);
+    #endif
+}
+
+inline int countSetBits(uint64_t word) {
+    #ifdef _MSC_VER
+        return (int)__popcnt64(word);
+    #else
+        return __builtin_popcountll(word);
+    #endif
+}
+
+// Word with the low n bits set (n in 0..64).
+inline uint64_t lowBits(int n) {
+    return n >= BITS_PER_WORD ? ~0ULL : ((1ULL << n) - 1);
+}
+
+#endif
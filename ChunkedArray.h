@@ -0,0 +1,63 @@
+#ifndef CHUNKEDARRAY_H
+#define CHUNKEDARRAY_H
+
+#include <new>
+#include <vector>
+
+// Growable array made of fixed-size chunks. Elements never move once
+// constructed, so indices and pointers into it stay valid as it grows,
+// and memory is allocated one chunk at a time as live data needs it.
+template <typename T, int CHUNK_BITS = 10>
+class ChunkedArray {
+private:
+    static const int CHUNK_SIZE = 1 << CHUNK_BITS;
+    static const int CHUNK_MASK = CHUNK_SIZE - 1;
+    
+    std::vector<T*> chunks;
+    int count;
+    
+public:
+    ChunkedArray() : count(0) {}
+    
+    ~ChunkedArray() {
+        clear();
+    }
+    
+    ChunkedArray(const ChunkedArray&) = delete;
+    ChunkedArray& operator=(const ChunkedArray&) = delete;
+    
+    T& operator[](int i) {
+        return chunks[i >> CHUNK_BITS][i & CHUNK_MASK];
+    }
+    
+    // Default-constructs elements until at least n exist
+    void ensureSize(int n) {
+        while (count < n) {
+            if ((count >> CHUNK_BITS) == (int)chunks.size()) {
+                chunks.push_back(static_cast<T*>(::operator new(sizeof(T) * CHUNK_SIZE)));
+            }
+            new (&chunks[count >> CHUNK_BITS][count & CHUNK_MASK]) T();
+            count++;
+        }
+    }
+    
+    T& append() {
+        ensureSize(count + 1);
+        return (*this)[count - 1];
+    }
+    
+    void clear() {
+        for (int i = 0; i < count; i++) {
+            (*this)[i].~T();
+        }
+        for (size_t c = 0; c < chunks.size(); c++) {
+            ::operator delete(chunks[c]);
+        }
+        chunks.clear();
+        count = 0;
+    }
+    
+    int size() { return count; }
+};
+
+#endif
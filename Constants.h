@@ -0,0 +1,34 @@
+#ifndef CONSTANTS_H
+#define CONSTANTS_H
+
+enum RequestState { REQUESTED, ALLOCATED, OCCUPIED, RELEASED, CANCELLED };
+
+// States a caller may move a request to. Only the allocator sets
+// ALLOCATED, as it is the one that hands out the slot.
+inline bool isClientTransition(int state) {
+    return state == OCCUPIED || state == RELEASED || state == CANCELLED;
+}
+
+// ParkingSystem::submitRequest() results other than a request ID
+const int REQUEST_REJECTED = -1;    // unknown vehicle/zone or already parked
+const int REQUEST_QUEUED = -2;      // no slot anywhere; vehicle is waiting
+const int REQUEST_FULL = -3;        // sharded mode: no slot anywhere, nothing queued
+
+// Slot attributes, and the same flags as a vehicle's requirements
+enum SlotAttribute {
+    SLOT_EV = 1,            // charger; kept for vehicles that need one
+    SLOT_ACCESSIBLE = 2,    // kept for permit holders
+    SLOT_COMPACT = 4,       // only vehicles marked compact fit
+    SLOT_OVERSIZE = 8       // the only slots an oversize vehicle fits
+};
+
+const int SLOT_ATTRIBUTE_COUNT = 4;
+const int SLOT_CLASSES = 1 << SLOT_ATTRIBUTE_COUNT;    // attribute combinations
+const int SLOT_REQUIRED = SLOT_EV | SLOT_ACCESSIBLE | SLOT_OVERSIZE;     // vehicle flag -> slot must have it
+const int SLOT_RESTRICTED = SLOT_EV | SLOT_ACCESSIBLE | SLOT_COMPACT;   // slot flag -> vehicle must have it
+
+inline bool slotFits(int attrs, int needs) {
+    return (needs & ~attrs & SLOT_REQUIRED) == 0 && (attrs & ~needs & SLOT_RESTRICTED) == 0;
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include <cstdint>
+#include <vector>
+
+// Open-addressing map from non-negative int keys to int values.
+// Linear probing with backward-shift deletion, so lookups never walk
+// tombstones and cost stays O(1) however much churn the map has seen.
+class IntHashIndex {
+private:
+    struct Entry {
+        int key;        // -1 = empty
+        int value;
+    };
+    
+    std::vector<Entry> table;
+    int count;
+    
+    int mask() { return (int)table.size() - 1; }
+    
+    int home(int key) {
+        uint32_t h = (uint32_t)key * 2654435761u;
+        return (int)(h ^ (h >> 16)) & mask();
+    }
+    
+    void grow() {
+        std::vector<Entry> old;
+        old.swap(table);
+        table.assign(old.empty() ? 16 : old.size() * 2, Entry{-1, -1});
+        count = 0;
+        for (size_t i = 0; i < old.size(); i++) {
+            if (old[i].key != -1) put(old[i].key, old[i].value);
+        }
+    }
+    
+public:
+    IntHashIndex() : count(0) {}
+    
+    void put(int key, int value) {
+        if ((count + 1) * 2 > (int)table.size()) grow();
+        int i = home(key);
+        while (table[i].key != -1 && table[i].key != key) i = (i + 1) & mask();
+        if (table[i].key == -1) count++;
+        table[i].key = key;
+        table[i].value = value;
+    }
+    
+    // Value stored for key, or -1
+    int get(int key) {
+        if (count == 0) return -1;
+        int i = home(key);
+        while (table[i].key != -1) {
+            if (table[i].key == key) return table[i].value;
+            i = (i + 1) & mask();
+        }
+        return -1;
+    }
+    
+    bool erase(int key) {
+        if (count == 0) return false;
+        int i = home(key);
+        while (table[i].key != key) {
+            if (table[i].key == -1) return false;
+            i = (i + 1) & mask();
+        }
+        // Shift later entries of the probe run back into the hole
+        int hole = i;
+        for (int j = (i + 1) & mask(); table[j].key != -1; j = (j + 1) & mask()) {
+            int h = home(table[j].key);
+            if (((j - h) & mask()) >= ((j - hole) & mask())) {
+                table[hole] = table[j];
+                hole = j;
+            }
+        }
+        table[hole].key = -1;
+        count--;
+        return true;
+    }
+    
+    void clear() {
+        table.clear();
+        count = 0;
+    }
+    
+    int size() { return count; }
+};
+
+#endif
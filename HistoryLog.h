@@ -0,0 +1,59 @@
+#ifndef HISTORYLOG_H
+#define HISTORYLOG_H
+
+#include "Constants.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+const int HISTORY_SEGMENT_BITS = 12;
+const int HISTORY_SEGMENT = 1 << HISTORY_SEGMENT_BITS;     // records per segment
+
+// Append-only log of request state changes, stored column by column in
+// fixed-size segments. A record costs 29 bytes, and a scan over one
+// column touches only that column. A full segment is sealed and never
+// changes again, so it can be compressed or spilled with writeSegment().
+class HistoryLog {
+private:
+    struct Segment {
+        int32_t requestID[HISTORY_SEGMENT];
+        int32_t vehicleID[HISTORY_SEGMENT];
+        int32_t requestedZone[HISTORY_SEGMENT];
+        int32_t allocatedZone[HISTORY_SEGMENT];
+        uint8_t state[HISTORY_SEGMENT];
+        float penalty[HISTORY_SEGMENT];
+        int64_t time[HISTORY_SEGMENT];      // TimeStamp nanoseconds
+        int size;
+    };
+    
+    std::vector<Segment*> segments;
+    long count;
+    int sealedCount;
+
+public:
+    HistoryLog();
+    ~HistoryLog();
+    
+    HistoryLog(const HistoryLog&) = delete;
+    HistoryLog& operator=(const HistoryLog&) = delete;
+    
+    void append(int rID, int vID, int reqZone, int allocZone,
+                RequestState state, float penalty);
+    
+    // Seals the partly filled tail segment; the next append starts a new one
+    void seal();
+    
+    long getCount();
+    int getSegmentCount();
+    int getSealedCount();
+    
+    // Column scans over every record
+    long countState(RequestState state);
+    double sumPenalty(RequestState state);
+    
+    // Writes a sealed segment's columns, in declaration order. False if
+    // the segment is not sealed or the write failed.
+    bool writeSegment(int seg, FILE* out);
+};
+
+#endif
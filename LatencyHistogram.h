@@ -0,0 +1,83 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include "Bitmap.h"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+const int LATENCY_SUB_BITS = 3;                         // 8 buckets per power of two
+const int LATENCY_BUCKETS = (2 << LATENCY_SUB_BITS) + ((63 - LATENCY_SUB_BITS) << LATENCY_SUB_BITS);
+
+// Log-linear histogram of nanosecond latencies: values below 16 ns get a
+// bucket each, above that every power of two is split in 8, so any
+// percentile is read to within 12.5%. One thread records; counters are
+// relaxed atomics so another thread can read while it does.
+class LatencyHistogram {
+private:
+    std::atomic<uint64_t> buckets[LATENCY_BUCKETS];
+    std::atomic<uint64_t> count, maxValue;
+    
+    static int bucketOf(uint64_t ns) {
+        const uint64_t linear = 2ULL << LATENCY_SUB_BITS;
+        if (ns < linear) return (int)ns;
+        int msb = highestSetBit(ns);
+        int sub = (int)(ns >> (msb - LATENCY_SUB_BITS)) & ((1 << LATENCY_SUB_BITS) - 1);
+        return (int)linear + ((msb - LATENCY_SUB_BITS - 1) << LATENCY_SUB_BITS) + sub;
+    }
+    
+    // Largest value that lands in bucket b
+    static uint64_t upperBound(int b) {
+        const int linear = 2 << LATENCY_SUB_BITS;
+        if (b < linear) return (uint64_t)b;
+        int msb = ((b - linear) >> LATENCY_SUB_BITS) + LATENCY_SUB_BITS + 1;
+        uint64_t sub = (uint64_t)((b - linear) & ((1 << LATENCY_SUB_BITS) - 1));
+        uint64_t low = (1ULL << msb) | (sub << (msb - LATENCY_SUB_BITS));
+        return low + (1ULL << (msb - LATENCY_SUB_BITS)) - 1;
+    }
+
+public:
+    LatencyHistogram() { reset(); }
+    
+    void reset() {
+        for (int b = 0; b < LATENCY_BUCKETS; b++) buckets[b].store(0, std::memory_order_relaxed);
+        count.store(0, std::memory_order_relaxed);
+        maxValue.store(0, std::memory_order_relaxed);
+    }
+    
+    void record(int64_t ns) {
+        uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+        std::atomic<uint64_t>& b = buckets[bucketOf(v)];
+        b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (v > maxValue.load(std::memory_order_relaxed)) maxValue.store(v, std::memory_order_relaxed);
+    }
+    
+    uint64_t getCount() { return count.load(std::memory_order_relaxed); }
+    uint64_t getMax() { return maxValue.load(std::memory_order_relaxed); }
+    
+    // Upper bound of the bucket holding the p-th percentile (0-100)
+    uint64_t percentile(double p) {
+        uint64_t total = getCount();
+        if (total == 0) return 0;
+        uint64_t rank = (uint64_t)(p / 100.0 * (double)total);
+        if (rank >= total) rank = total - 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            seen += buckets[b].load(std::memory_order_relaxed);
+            if (seen > rank) {
+                uint64_t bound = upperBound(b);
+                return bound < getMax() ? bound : getMax();
+            }
+        }
+        return getMax();
+    }
+    
+    void display() {
+        std::cout << "Latency (" << getCount() << " events): p50 " << percentile(50)
+                  << " ns | p90 " << percentile(90) << " ns | p99 " << percentile(99)
+                  << " ns | p99.9 " << percentile(99.9) << " ns | max " << getMax() << " ns\n";
+    }
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef MINCOSTFLOW_H
+#define MINCOSTFLOW_H
+
+#include <vector>
+
+// Min-cost max-flow on a small directed graph with non-negative integer
+// costs. Primal-dual: each phase finds shortest distances with Dijkstra
+// on reduced costs, then pushes a blocking flow (Dinic) through every
+// edge whose reduced cost is zero. The number of phases is bounded by the
+// number of distinct path costs, which is small when costs are a handful
+// of penalty values.
+class MinCostFlow {
+private:
+    struct Edge {
+        int from, to;
+        int cap, cost;
+    };
+    
+    std::vector<Edge> edges;        // edge e and its reverse are e ^ 1
+    std::vector<int> start, order;  // edges grouped by from node
+    std::vector<long> potential, dist;
+    std::vector<int> level, next;
+    int nodeCount;
+    
+    long reducedCost(int e);
+    bool shortestPaths(int s, int t);
+    bool buildLevels(int s, int t);
+    int push(int u, int t, int limit);
+
+public:
+    explicit MinCostFlow(int nodes);
+    
+    // Index of the new edge, for getFlow()
+    int addEdge(int from, int to, int cap, int cost);
+    
+    // Sends as much flow from s to t as fits, at least total cost.
+    // Returns the cost; flow is set to the amount sent.
+    long solve(int s, int t, long& flow);
+    int getFlow(int edge);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef MPSCRING_H
+#define MPSCRING_H
+
+#include "SpscRing.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bounded multi-producer, single-consumer ring. Each cell carries a
+// sequence number saying whether it is ready to be written or read, so a
+// producer claims a cell with one compare-and-swap on the tail and then
+// publishes it with a store; nothing ever waits on a lock, and a full
+// ring is reported rather than waited out.
+template <typename T>
+class MpscRing {
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T item;
+    };
+    
+    std::vector<Cell> cells;
+    size_t mask;
+    
+    alignas(CACHE_LINE) std::atomic<size_t> tail;   // next cell to claim; producers
+    alignas(CACHE_LINE) size_t head;                // next cell to read; consumer only
+
+public:
+    // capacity must be a power of two
+    explicit MpscRing(size_t capacity) : cells(capacity), mask(capacity - 1), tail(0), head(0) {
+        for (size_t i = 0; i < capacity; i++) cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+    
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+    
+    // Any thread. False when full.
+    bool push(const T& item) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            intptr_t diff = (intptr_t)cell->seq.load(std::memory_order_acquire) - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->item = item;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer only. A claimed cell counts as empty until it is published.
+    bool isEmpty() {
+        return cells[head & mask].seq.load(std::memory_order_acquire) != head + 1;
+    }
+    
+    // Consumer only. False when empty, or when the next cell is claimed
+    // but not yet published.
+    bool pop(T& item) {
+        Cell& cell = cells[head & mask];
+        if (cell.seq.load(std::memory_order_acquire) != head + 1) return false;
+        item = cell.item;
+        cell.seq.store(head + mask + 1, std::memory_order_release);
+        head++;
+        return true;
+    }
+};
+
+#endif
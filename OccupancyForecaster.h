@@ -0,0 +1,54 @@
+#ifndef OCCUPANCYFORECASTER_H
+#define OCCUPANCYFORECASTER_H
+
+#include "Zone.h"
+#include "ChunkedArray.h"
+#include "TimeStamp.h"
+#include <cstdint>
+#include <vector>
+
+const int FORECAST_BUCKET_SECONDS = 60;     // rates are per one-minute bucket
+const float FORECAST_ALPHA = 0.3f;          // weight of the newest closed bucket
+const float FILLING_THRESHOLD = 0.9f;       // forecast occupancy that marks a zone as filling
+const int FORECAST_HORIZON = 15;            // minutes ahead on the analytics screen
+
+// Streaming per-zone arrival and departure rates. Slot claims and frees
+// are counted in the bucket they fall in; when a bucket closes its counts
+// fold into exponentially decayed rates, and buckets with no events at
+// all decay the rates in one step. Each zone holds a fixed handful of
+// fields, so recording an event is O(1) however long the system runs.
+// A forecast carries the current occupancy forward at the net rate.
+class OccupancyForecaster {
+private:
+    struct ZoneRates {
+        int64_t bucket;                 // bucket being counted
+        int arrivals, departures;       // in that bucket
+        float arrivalRate, departureRate;   // per bucket, over closed buckets
+        
+        ZoneRates() : bucket(0), arrivals(0), departures(0),
+                      arrivalRate(0), departureRate(0) {}
+    };
+    
+    std::vector<ZoneRates> zones;
+    
+    static int64_t bucketOf(TimeStamp when);
+    static void roll(ZoneRates& r, int64_t bucket);
+
+public:
+    void addZone();
+    
+    void recordArrival(int zone, TimeStamp when);
+    void recordDeparture(int zone, TimeStamp when);
+    
+    // Events per minute as of now
+    float getArrivalRate(int zone, TimeStamp now = TimeStamp());
+    float getDepartureRate(int zone, TimeStamp now = TimeStamp());
+    
+    // Occupied slots expected minutes after now, from occupied of capacity now
+    float predict(int zone, int occupied, int capacity, int minutes, TimeStamp now = TimeStamp());
+    // Expected occupancy rate (0-1) of every zone, minutes ahead. O(zones).
+    void forecast(ChunkedArray<Zone>& zoneData, int zoneCount, int minutes,
+                  std::vector<float>& rates, TimeStamp now = TimeStamp());
+};
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef PARKINGAREA_H
+#define PARKINGAREA_H
+
+#include "Bitmap.h"
+#include "Constants.h"
+#include "ParkingSlot.h"
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+// Slot ownership lives in the atomic free bitmap: whoever flips a bit
+// from 1 to 0 owns that slot until it is released, so claims need no lock.
+// Slot attributes are fixed bitmaps, one per attribute. ANDing them into a
+// free word gives the free slots of one attribute class, so the first free
+// EV slot is found a word at a time like any other.
+class ParkingArea {
+private:
+    int areaID, zoneID;
+    std::vector<ParkingSlot> slots;                 // sized once in init(), never reallocated
+    std::vector<std::atomic<uint64_t>> freeMask;    // bit i set = slot i is free
+    std::vector<uint64_t> attrMask;     // attribute a, word w at a * words + w
+    std::vector<uint8_t> slotAttrs;
+    int attrsPresent;                   // every attribute some slot here has
+    int totalSlots;
+    std::atomic<int> availableSlots;
+    
+    // Slots in word w whose attributes suit needs. ~0 when no slot here
+    // has an attribute that matters to needs.
+    uint64_t matchWord(int w, int needs) {
+        int require = needs & SLOT_REQUIRED, avoid = attrsPresent & ~needs & SLOT_RESTRICTED;
+        uint64_t match = ~0ULL;
+        if ((require | avoid) == 0) return match;
+        int words = (int)freeMask.size();
+        for (int a = 0; a < SLOT_ATTRIBUTE_COUNT; a++) {
+            if (require & (1 << a)) match &= attrMask[a * words + w];
+            if (avoid & (1 << a)) match &= ~attrMask[a * words + w];
+        }
+        return match;
+    }
+    
+    bool isFree(int slotID) {
+        return (freeMask[slotID / BITS_PER_WORD].load() >> (slotID % BITS_PER_WORD)) & 1;
+    }
+    
+    // Atomically clears bit if set; true if this caller cleared it
+    bool takeBit(int slotID) {
+        uint64_t bit = 1ULL << (slotID % BITS_PER_WORD);
+        return freeMask[slotID / BITS_PER_WORD].fetch_and(~bit) & bit;
+    }
+    
+public:
+    ParkingArea() : areaID(-1), zoneID(-1), attrsPresent(0), totalSlots(0), availableSlots(0) {}
+    
+    void init(int a, int z, int numSlots) {
+        areaID = a;
+        zoneID = z;
+        totalSlots = numSlots;
+        availableSlots = numSlots;
+        
+        slots.assign(totalSlots, ParkingSlot());
+        for (int i = 0; i < totalSlots; i++) {
+            slots[i].init(i, zoneID, areaID);
+        }
+        freeMask = std::vector<std::atomic<uint64_t>>(wordsFor(totalSlots));
+        for (int w = 0; w < (int)freeMask.size(); w++) {
+            freeMask[w] = lowBits(totalSlots - w * BITS_PER_WORD);
+        }
+        attrMask.assign(SLOT_ATTRIBUTE_COUNT * freeMask.size(), 0);
+        slotAttrs.assign(totalSlots, 0);
+        attrsPresent = 0;
+    }
+    
+    // City layout, before slots are claimed from several threads
+    bool setSlotAttributes(int slotID, int attrs) {
+        if (slotID < 0 || slotID >= totalSlots || attrs < 0 || attrs >= SLOT_CLASSES) return false;
+        int words = (int)freeMask.size();
+        uint64_t bit = 1ULL << (slotID % BITS_PER_WORD);
+        for (int a = 0; a < SLOT_ATTRIBUTE_COUNT; a++) {
+            uint64_t& word = attrMask[a * words + slotID / BITS_PER_WORD];
+            word = (attrs & (1 << a)) ? word | bit : word & ~bit;
+        }
+        slotAttrs[slotID] = (uint8_t)attrs;
+        attrsPresent = 0;
+        for (int k = 0; k < (int)attrMask.size(); k++) {
+            if (attrMask[k]) attrsPresent |= 1 << (k / words);
+        }
+        return true;
+    }
+    int getSlotAttributes(int slotID) { return slotAttrs[slotID]; }
+    int getAttributesPresent() { return attrsPresent; }
+    
+    // First free slot suiting needs, found with one find-first-set per
+    // bitmap word. Only a hint under concurrency; use claimSlot() to take it.
+    ParkingSlot* findSlot(int needs = 0) {
+        if (needs & SLOT_REQUIRED & ~attrsPresent) return nullptr;
+        for (int w = 0; w < (int)freeMask.size(); w++) {
+            uint64_t word = freeMask[w].load() & matchWord(w, needs);
+            if (word) {
+                return &slots[w * BITS_PER_WORD + lowestSetBit(word)];
+            }
+        }
+        return nullptr;
+    }
+    
+    // Finds and takes the first free slot suiting needs with
+    // compare-and-swap on the bitmap word; nullptr if there is none
+    ParkingSlot* claimSlot(int vID, int needs = 0) {
+        if (needs & SLOT_REQUIRED & ~attrsPresent) return nullptr;
+        for (int w = 0; w < (int)freeMask.size(); w++) {
+            uint64_t match = matchWord(w, needs);
+            uint64_t word = freeMask[w].load();
+            while (word & match) {
+                uint64_t usable = word & match;
+                uint64_t bit = usable & (~usable + 1);
+                if (freeMask[w].compare_exchange_weak(word, word & ~bit)) {
+                    availableSlots--;
+                    ParkingSlot* slot = &slots[w * BITS_PER_WORD + lowestSetBit(bit)];
+                    slot->occupy(vID);
+                    return slot;
+                }
+            }
+        }
+        return nullptr;
+    }
+    
+    bool hasSlotsFor(int needs) {
+        return findSlot(needs) != nullptr;
+    }
+    
+    // Takes up to n free slots without requirements, lowest first, for
+    // vIDs[0..n-1]: one compare-and-swap per bitmap word rather than one
+    // per slot. Returns how many were taken; the slots are appended to out.
+    int claimSlots(int n, const int* vIDs, std::vector<ParkingSlot*>& out) {
+        int taken = 0;
+        for (int w = 0; w < (int)freeMask.size() && taken < n; w++) {
+            uint64_t match = matchWord(w, 0);
+            uint64_t word = freeMask[w].load();
+            uint64_t bits = 0;
+            while (word & match) {
+                // Lowest (n - taken) usable bits of word
+                bits = 0;
+                uint64_t rest = word & match;
+                for (int k = taken; k < n && rest; k++) {
+                    uint64_t bit = rest & (~rest + 1);
+                    bits |= bit;
+                    rest &= rest - 1;
+                }
+                if (freeMask[w].compare_exchange_weak(word, word & ~bits)) break;
+                bits = 0;
+            }
+            while (bits) {
+                ParkingSlot* slot = &slots[w * BITS_PER_WORD + lowestSetBit(bits)];
+                slot->occupy(vIDs[taken++]);
+                out.push_back(slot);
+                bits &= bits - 1;
+            }
+        }
+        availableSlots -= taken;
+        return taken;
+    }
+    
+    bool releaseSlot(int slotID) {
+        if (slotID < 0 || slotID >= totalSlots || isFree(slotID)) return false;
+        slots[slotID].free();
+        uint64_t bit = 1ULL << (slotID % BITS_PER_WORD);
+        if (freeMask[slotID / BITS_PER_WORD].fetch_or(bit) & bit) return false;
+        availableSlots++;
+        return true;
+    }
+    
+    bool occupySlot(int slotID, int vID) {
+        if (slotID >= 0 && slotID < totalSlots && takeBit(slotID)) {
+            slots[slotID].occupy(vID);
+            availableSlots--;
+            return true;
+        }
+        return false;
+    }
+    
+    bool hasSlots() {
+        for (int w = 0; w < (int)freeMask.size(); w++) {
+            if (freeMask[w].load()) return true;
+        }
+        return false;
+    }
+    int getAvailable() { return availableSlots; }
+    int getTotal() { return totalSlots; }
+    // Vehicle parked in slotID, or -1 if the slot is free
+    int getOccupant(int slotID) { return isFree(slotID) ? -1 : slots[slotID].getVehicleID(); }
+    int getAreaID() { return areaID; }
+    
+    void display() {
+        std::cout << "  Area " << areaID << ": " << availableSlots << "/" << totalSlots << " slots available\n";
+    }
+};
+
+#endif
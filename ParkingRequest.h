@@ -0,0 +1,50 @@
+#ifndef PARKINGREQUEST_H
+#define PARKINGREQUEST_H
+
+#include "Constants.h"
+#include "TimeStamp.h"
+#include <string>
+#include <iostream>
+#include <iomanip>
+
+class RequestStats;
+
+class ParkingRequest {
+private:
+    int requestID, vehicleID, requestedZone;
+    int allocatedZone, allocatedArea, allocatedSlot;
+    RequestState state;
+    float penalty;
+    TimeStamp requestTime, allocationTime, releaseTime;
+    RequestStats* stats;        // notified of terminal transitions; may be null
+    
+public:
+    ParkingRequest();
+    
+    void init(int rID, int vID, int zone, RequestStats* s = nullptr);
+    bool canTransition(RequestState newState);
+    bool changeState(RequestState newState);
+    void setAllocation(int z, int a, int s, float p);
+    
+    int getRequestID();
+    int getVehicleID();
+    int getRequestedZone();
+    int getAllocatedZone();
+    int getAllocatedArea();
+    int getAllocatedSlot();
+    RequestState getState();
+    float getPenalty();
+    
+    void setState(RequestState s);
+    // Puts back a request saved in a snapshot, after init/setAllocation
+    void restore(RequestState s, TimeStamp req, TimeStamp alloc, TimeStamp rel);
+    TimeStamp getRequestTime();
+    TimeStamp getAllocationTime();
+    TimeStamp getReleaseTime();
+    bool isCrossZone();
+    float getDuration();
+    std::string getStateString();
+    void display();
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef PARKINGSLOT_H
+#define PARKINGSLOT_H
+
+// One parking space. Whether it is free is decided by its area's bitmap;
+// the slot only records who holds it, written by the owner of the bit.
+class ParkingSlot {
+private:
+    int slotID, zoneID, areaID;
+    bool available;
+    int vehicleID;
+    
+public:
+    ParkingSlot() : slotID(-1), zoneID(-1), areaID(-1), 
+                    available(true), vehicleID(-1) {}
+    
+    void init(int s, int z, int a) {
+        slotID = s;
+        zoneID = z;
+        areaID = a;
+        available = true;
+        vehicleID = -1;
+    }
+    
+    bool isAvailable() { return available; }
+    int getSlotID() { return slotID; }
+    int getZoneID() { return zoneID; }
+    int getAreaID() { return areaID; }
+    int getVehicleID() { return vehicleID; }
+    
+    void occupy(int vID) {
+        available = false;
+        vehicleID = vID;
+    }
+    
+    void free() {
+        available = true;
+        vehicleID = -1;
+    }
+};
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef PARKINGSYSTEM_H
+#define PARKINGSYSTEM_H
+
+#include "Constants.h"
+#include "Zone.h"
+#include "Vehicle.h"
+#include "ParkingRequest.h"
+#include "RollbackManager.h"
+#include "AllocationEngine.h"
+#include "ChunkedArray.h"
+#include "HashIndex.h"
+#include "PlateIndex.h"
+#include "RequestStats.h"
+#include "HistoryLog.h"
+#include "OccupancyForecaster.h"
+#include "TimerWheel.h"
+#include "WriteAheadLog.h"
+#include <string>
+#include <vector>
+
+class WaitingQueue;
+
+class ParkingSystem {
+private:
+    ChunkedArray<Zone> zones;
+    int zoneCount;
+    
+    ChunkedArray<Vehicle> vehicles;
+    int vehicleCount;
+    std::vector<int> vehicleNeeds;     // vehicle ID -> SlotAttribute flags it needs
+    int attributedSlots;               // slots with any attribute, city-wide
+    
+    ChunkedArray<ParkingRequest> requests;
+    int requestCount;
+    
+    HistoryLog history;
+    WriteAheadLog* wal;                // not owned; null when not logging
+    uint64_t logSequence;              // last log frame reflected in this state
+    bool groupCommit;                  // the caller commits the log, not each operation
+    int opDepth;                       // core operations under way, nested ones included
+    WaitingQueue* waitQueue;
+    RollbackManager rollbackMgr;
+    AllocationEngine allocEngine;
+    TimerWheel holdTimers;             // ALLOCATED request ID -> expiry, in ms
+    int holdTimeout;                   // seconds; 0 = holds never expire
+    OccupancyForecaster forecaster;
+    int forecastHorizon;               // minutes; 0 = no steering
+    
+    RequestStats stats;
+    std::vector<int> zoneUsage;
+    
+    IntHashIndex activeByVehicle;      // vehicle ID -> ALLOCATED/OCCUPIED request ID
+    PlateIndex plateIndex;             // license plate -> vehicle ID
+    
+    std::vector<std::vector<int>> adjacentFrom;    // zone -> zones listing it as adjacent
+    std::vector<int> servedFromQueue;              // requests served by the last operation
+    
+    // Commits the log when the outermost core operation returns, so what
+    // it reports is durable unless commits are grouped
+    struct LogCommit {
+        ParkingSystem& system;
+        explicit LogCommit(ParkingSystem& s) : system(s) { system.opDepth++; }
+        ~LogCommit() {
+            if (--system.opDepth == 0 && system.wal && !system.groupCommit) system.wal->commit();
+        }
+    };
+    
+    void syncActiveIndex(int rID);
+    void syncHoldTimer(int rID);
+    // planned: slots a batch plan has taken in zone but not yet claimed
+    void steer(int zone, TimeStamp now, int planned = 0);
+    static void steerPlanned(void* context, int zone, int planned);
+    void logState(int rID);
+    bool logOp(WalOp op, int a, int b, const char* text = nullptr);
+    void listWaiting(std::vector<int>& vIDs, std::vector<int>& zones);
+    bool addWaiting(int vID, int zone);
+    int createRequest(int vID, int zone);
+    int recordAllocation(int vID, int zone, int allocZone, int allocArea, 
+                         int allocSlot, float penalty);
+    void serveWaiting(int zone);
+    void showServedFromQueue();
+    bool allocate(int reqZone, int vID, int& allocZone, int& allocArea, 
+                  int& allocSlot, float& penalty);
+    
+public:
+    ParkingSystem();
+    ~ParkingSystem();
+    
+    // Core operations: no console I/O, safe to drive headless
+    // -1 for a zone too large for the rollback journal to address
+    int addZone(const std::string& name, int numAreas, int* areaCapacities);
+    bool addAdjacency(int fromZone, int toZone);
+    void setupCity();
+    // needs: SlotAttribute flags. EV, accessible and oversize vehicles
+    // only take slots with that attribute; compact ones may also take
+    // compact slots. EV, accessible and compact slots are kept for them.
+    int addVehicle(const std::string& plate, int preferredZone, int needs = 0);
+    int getVehicleNeeds(int vID);
+    // City layout, like addZone(): not logged, and set before use
+    bool setSlotAttributes(int zone, int area, int slot, int attrs);
+    int submitRequest(int vID, int zone);
+    // Several requests at once. In order, results[i] is what submitRequest()
+    // would return. For least penalty, vehicles with requirements are
+    // placed first, and waiters may be served too.
+    void submitBatch(const std::vector<BatchRequest>& batch, std::vector<int>& results,
+                     BatchMode mode = BATCH_IN_ORDER);
+    bool transitionRequest(int rID, RequestState newState);
+    int rollbackOperations(int k, std::vector<int>* rolledBack = nullptr);
+    // Oldest operations beyond maxEntries can no longer be rolled back; 0 = keep all
+    void setRollbackRetention(int maxEntries);
+    
+    // An ALLOCATED request not OCCUPIED within seconds of its allocation
+    // is cancelled by the next expireHolds(); 0 = never (the default)
+    void setHoldTimeout(int seconds);
+    int getHoldTimeout();
+    int getHoldCount();                 // ALLOCATED requests with a timer running
+    // Cancels every hold past its timeout at now, as transitionRequest()
+    // does, and returns how many. Waiters served then go to
+    // getServedFromQueue().
+    int expireHolds(TimeStamp now = TimeStamp(), std::vector<int>* expired = nullptr);
+    // TimeStamp nanoseconds from which expireHolds() may have work; -1 if
+    // no hold is timed. Never later than the next hold's timeout.
+    int64_t nextHoldCheck();
+    
+    // Every slot claim and free feeds the forecaster. With a horizon set,
+    // a zone forecast to be FILLING_THRESHOLD full that many minutes ahead
+    // is tried after the other zones at its distance; 0 = off (the
+    // default). In-order batches are steered request by request, as
+    // submitRequest() is; least-penalty batches ignore the marks. Rates
+    // follow the wall clock, so replayLog() may seat a request in another
+    // zone at the same penalty than the logged run did.
+    void setForecastHorizon(int minutes);
+    int getForecastHorizon();
+    // Marks are updated per event for the zone it touched; this redoes
+    // every zone, for rates that have decayed since. O(zones).
+    void refreshForecast(TimeStamp now = TimeStamp());
+    // Expected occupancy rate (0-1) of every zone, minutes ahead
+    void forecastOccupancy(int minutes, std::vector<float>& rates, TimeStamp now = TimeStamp());
+    OccupancyForecaster& getForecaster();
+    
+    // Waiting vehicles allocated by the last submit/transition/rollback
+    const std::vector<int>& getServedFromQueue();
+    // Place in line (1-based) for the zone vID is waiting on, among
+    // waiters with the same requirements; 0 if not waiting
+    int getQueuePosition(int vID, int& zone);
+    
+    ParkingRequest* getRequest(int rID);
+    Zone* getZone(int zone);
+    RequestStats& getStats();
+    int getZoneUsage(int zone);         // allocations made in zone, net of rollbacks
+    HistoryLog& getHistory();
+    
+    // Binary snapshot of zones, slots, vehicles, requests, the waiting
+    // queue and the rollback stack. Loading needs an empty system.
+    bool saveSnapshot(const char* path);
+    bool loadSnapshot(const char* path);
+    
+    // Write-ahead logging of vehicle registration, requests, transitions
+    // and rollbacks. Recovery is loadSnapshot() (or the same setup code),
+    // then replayLog(), then attachLog() to carry on logging. Each core
+    // operation commits the log before it returns; with group commit on,
+    // frames wait for the caller's commit() instead, as RequestPipeline
+    // does once per batch.
+    void attachLog(WriteAheadLog* log);
+    void setGroupCommit(bool on);
+    long replayLog(const char* path);       // frames applied, -1 if unreadable
+    bool checkpoint(const char* snapshotPath);
+    uint64_t getLogSequence();
+    int getZoneCount();
+    int getVehicleCount();
+    int getRequestCount();
+    int getActiveCount();               // requests ALLOCATED or OCCUPIED
+    
+    // Interactive screens
+    void initCity();
+    void registerVehicle();
+    void requestParking();
+    void changeState();
+    void rollback();
+    void showAnalytics();
+    void showVehicles();
+    void showRequests();
+    void showZoneDetails();
+    void runDemo();
+    void mainMenu();
+    
+    int findVehicleByPlate(const std::string& plate);
+    int findActiveRequest(int vID);
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef PLATEINDEX_H
+#define PLATEINDEX_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+const int PLATE_KEY_CHARS = 16;
+
+// License plate packed into two words: letters and digits only,
+// upper-cased, zero padded. "abc-123" and "ABC 123" give the same key,
+// matching what gate cameras read.
+struct PlateKey {
+    uint64_t words[2];
+    
+    // False if the plate has no usable characters or is too long
+    bool set(const char* plate) {
+        char buffer[PLATE_KEY_CHARS] = {0};
+        int len = 0;
+        for (const char* p = plate; *p; p++) {
+            char c = *p;
+            if (c >= 'a' && c <= 'z') c = c - 'a' + 'A';
+            if (!((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))) continue;
+            if (len == PLATE_KEY_CHARS) return false;
+            buffer[len++] = c;
+        }
+        memcpy(words, buffer, sizeof(words));
+        return len > 0;
+    }
+    
+    bool isEmpty() { return words[0] == 0; }
+    
+    bool operator==(const PlateKey& other) const {
+        return words[0] == other.words[0] && words[1] == other.words[1];
+    }
+    
+    uint64_t hash() const {
+        uint64_t h = words[0] * 0x9E3779B97F4A7C15ULL ^ words[1] * 0xC2B2AE3D27D4EB4FULL;
+        return h ^ (h >> 29);
+    }
+};
+
+// Flat open-addressing map from plate to vehicle ID. Lookups build the
+// key on the stack and never allocate.
+class PlateIndex {
+private:
+    struct Entry {
+        PlateKey key;       // empty key = free bucket
+        int vehicleID;
+    };
+    
+    std::vector<Entry> table;
+    int count;
+    
+    int mask() { return (int)table.size() - 1; }
+    
+    int probe(const PlateKey& key) {
+        int i = (int)(key.hash() & mask());
+        while (!table[i].key.isEmpty() && !(table[i].key == key)) i = (i + 1) & mask();
+        return i;
+    }
+    
+    void grow() {
+        std::vector<Entry> old;
+        old.swap(table);
+        Entry empty = {{{0, 0}}, -1};
+        table.assign(old.empty() ? 64 : old.size() * 2, empty);
+        for (size_t i = 0; i < old.size(); i++) {
+            if (!old[i].key.isEmpty()) table[probe(old[i].key)] = old[i];
+        }
+    }
+    
+public:
+    PlateIndex() : count(0) {}
+    
+    // False if the plate is invalid or already registered
+    bool insert(const std::string& plate, int vehicleID) {
+        PlateKey key;
+        if (!key.set(plate.c_str())) return false;
+        if ((count + 1) * 2 > (int)table.size()) grow();
+        int i = probe(key);
+        if (!table[i].key.isEmpty()) return false;
+        table[i].key = key;
+        table[i].vehicleID = vehicleID;
+        count++;
+        return true;
+    }
+    
+    // Vehicle ID registered under plate, or -1
+    int find(const char* plate) {
+        PlateKey key;
+        if (count == 0 || !key.set(plate)) return -1;
+        return table[probe(key)].vehicleID;
+    }
+    
+    int find(const std::string& plate) { return find(plate.c_str()); }
+    
+    int size() { return count; }
+};
+
+#endif
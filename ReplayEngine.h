@@ -0,0 +1,49 @@
+#ifndef REPLAYENGINE_H
+#define REPLAYENGINE_H
+
+#include "ParkingSystem.h"
+#include <cstdio>
+#include <vector>
+
+// Headless driver for ParkingSystem. Reads one event per line and writes
+// one CSV record per event, with no per-event console I/O:
+//
+//   zone <name> <cap>[,<cap>...]     adjacent <fromZone> <toZone>
+//   register <plate> <zone>          request <vehicleID> <zone>
+//   occupy <requestID>               release <requestID>
+//   cancel <requestID>               rollback <k>
+//
+// Blank lines and lines starting with '#' are skipped. If no zone has
+// been defined by the first other event, the default city is set up.
+// Output columns: line,event,result,id,zone,area,slot,penalty. A release,
+// cancel or rollback that lets a waiting vehicle park is followed by a
+// "serve" record for the new request, on the same line number.
+class ReplayEngine {
+private:
+    ParkingSystem& system;
+    std::vector<char> out;
+    FILE* outFile;
+    long eventCount, errorCount;
+    
+    void applyLine(char* line, long lineNo);
+    void flush();
+    
+    void put(const char* text);
+    void putInt(long value);
+    void putPenalty(float penalty);
+    void record(long lineNo, const char* event, const char* result, long id = -1);
+    void recordAllocation(long lineNo, const char* event, int rID);
+    void recordServed(long lineNo);
+    
+public:
+    ReplayEngine(ParkingSystem& sys);
+    
+    // "-" means stdin / stdout. False if a file could not be opened.
+    bool run(const char* inputPath, const char* outputPath);
+    void run(FILE* in, FILE* outStream);
+    
+    long getEventCount();
+    long getErrorCount();
+};
+
+#endif
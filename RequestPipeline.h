@@ -0,0 +1,102 @@
+#ifndef REQUESTPIPELINE_H
+#define REQUESTPIPELINE_H
+
+#include "LatencyHistogram.h"
+#include "MpscRing.h"
+#include "ParkingSystem.h"
+#include "WriteAheadLog.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+const int PIPELINE_FULL = -4;       // ingress ring full or pipeline stopped; not posted
+const int PIPELINE_UNLOGGED = -5;   // applied, but the log could not make it durable
+const int PIPELINE_BATCH = 256;     // most events applied per WAL commit
+
+enum PipelineOp {
+    PIPE_SUBMIT,        // a = vehicle ID, b = zone; result as submitRequest()
+    PIPE_TRANSITION,    // a = request ID, b = new state; result 1 or 0
+    PIPE_ROLLBACK       // a = operation count; result = operations undone
+};
+
+// Asynchronous front end to a ParkingSystem. Any number of threads (gate
+// terminals) post events into a lock-free MPSC ring and return at once;
+// one engine thread drains the ring in batches, applies each event to the
+// system in arrival order, commits the write-ahead log once per batch if
+// one is given, and then completes every event in the batch through its
+// callback or future. A batch the log cannot commit, even on retry, is
+// completed with PIPELINE_UNLOGGED for every event; its frames stay
+// pending for the next commit. Holds are expired once the hold timers
+// reach their next tick, busy or idle. Posting never blocks: a full ring
+// is reported to the caller. An idle engine spins briefly, yields for a millisecond,
+// then sleeps until a post wakes it or the next hold is due. End-to-end
+// latency, post to completion, goes into a histogram.
+//
+// While the pipeline runs, only its engine thread may touch the system.
+class RequestPipeline {
+public:
+    // Runs on the engine thread; must not call back into the system
+    typedef void (*Callback)(void* context, int result);
+
+private:
+    struct Event {
+        int op, a, b;
+        int64_t postedNanos;
+        Callback callback;
+        void* context;
+        std::promise<int>* promise;
+    };
+    
+    ParkingSystem& system;
+    WriteAheadLog* log;
+    MpscRing<Event> ring;
+    std::thread engine;
+    std::atomic<bool> running, stopping;
+    std::atomic<int> posting;           // producers between their stop check and push
+    std::atomic<long> batches, events, failedCommits;
+    LatencyHistogram latency;
+    
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    std::atomic<bool> sleeping;         // engine is parking or parked
+    
+    void run();
+    void expireDue();
+    bool commitLog();
+    void park();
+    void wakeEngine();
+    int apply(const Event& e);
+    bool post(const Event& e);
+    std::future<int> postAsync(PipelineOp op, int a, int b);
+
+public:
+    // capacity must be a power of two
+    explicit RequestPipeline(ParkingSystem& target, WriteAheadLog* wal = nullptr, 
+                             int capacity = 65536);
+    ~RequestPipeline();
+    
+    RequestPipeline(const RequestPipeline&) = delete;
+    RequestPipeline& operator=(const RequestPipeline&) = delete;
+    
+    bool start();
+    // Applies and completes everything already posted, then stops
+    void stop();
+    
+    // Any thread. False (nothing posted, no callback) when full or stopped.
+    bool post(PipelineOp op, int a, int b, Callback callback, void* context);
+    // Any thread. The future holds PIPELINE_FULL if the event was not posted.
+    std::future<int> submitAsync(int vID, int zone);
+    std::future<int> transitionAsync(int rID, RequestState newState);
+    std::future<int> rollbackAsync(int k);
+    
+    LatencyHistogram& getLatency();
+    long getBatchCount();
+    long getEventCount();
+    long getFailedCommitCount();
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef REQUESTSTATS_H
+#define REQUESTSTATS_H
+
+#include "ParkingRequest.h"
+#include <vector>
+
+// Running totals behind the analytics screen. ParkingRequest::changeState()
+// adds a request's contribution when it reaches RELEASED or CANCELLED and
+// setState() takes it back out on rollback, so reading them is O(zones)
+// no matter how long the history gets. Per-zone figures are keyed by the
+// zone the request was allocated in.
+class RequestStats {
+private:
+    struct ZoneStats {
+        int completed, cancelled, crossZone;
+        double hours;
+        
+        ZoneStats() : completed(0), cancelled(0), crossZone(0), hours(0) {}
+    };
+    
+    std::vector<ZoneStats> zones;
+    ZoneStats total;
+    
+    static float average(const ZoneStats& s) {
+        return s.completed > 0 ? (float)(s.hours / s.completed) : 0;
+    }
+
+public:
+    void addZone() { zones.push_back(ZoneStats()); }
+    
+    // sign is +1 when req enters its current state, -1 when it leaves it
+    void record(ParkingRequest& req, int sign) {
+        RequestState state = req.getState();
+        if (state != RELEASED && state != CANCELLED) return;
+        
+        int z = req.getAllocatedZone();
+        ZoneStats* zs = (z >= 0 && z < (int)zones.size()) ? &zones[z] : nullptr;
+        if (state == CANCELLED) {
+            total.cancelled += sign;
+            if (zs) zs->cancelled += sign;
+            return;
+        }
+        
+        double hours = req.getDuration() * sign;
+        int cross = req.isCrossZone() ? sign : 0;
+        total.completed += sign;
+        total.hours += hours;
+        total.crossZone += cross;
+        if (zs) {
+            zs->completed += sign;
+            zs->hours += hours;
+            zs->crossZone += cross;
+        }
+    }
+    
+    int getCompleted() { return total.completed; }
+    int getCancelled() { return total.cancelled; }
+    int getCrossZone() { return total.crossZone; }
+    float getAvgDuration() { return average(total); }
+    
+    int getZoneCompleted(int z) { return zones[z].completed; }
+    int getZoneCancelled(int z) { return zones[z].cancelled; }
+    int getZoneCrossZone(int z) { return zones[z].crossZone; }
+    float getZoneAvgDuration(int z) { return average(zones[z]); }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef ROLLBACKMANAGER_H
+#define ROLLBACKMANAGER_H
+
+#include "Constants.h"
+#include "TimeStamp.h"
+#include <cstdint>
+#include <deque>
+
+struct RollbackEntry {
+    int requestID;
+    int zone, area, slot;
+    RequestState prevState;
+    TimeStamp timestamp;
+    
+    RollbackEntry();
+    RollbackEntry(int r, int z, int a, int s, RequestState st);
+};
+
+const int ROLLBACK_SEGMENT_BITS = 10;
+const int ROLLBACK_SEGMENT = 1 << ROLLBACK_SEGMENT_BITS;
+
+// Undo journal, newest entry on top. Entries are packed into 16 bytes:
+// the request ID, milliseconds since the first entry of their segment, and
+// zone/area/slot/state in one word. It grows a segment at a time; with a
+// retention limit set, each push past the limit drops the oldest entry
+// and a segment that empties is recycled, so trimming is O(1).
+class RollbackManager {
+private:
+    struct PackedEntry {
+        int32_t requestID;
+        uint32_t timeDelta;     // milliseconds after the segment's baseTime
+        uint64_t location;      // zone:20 | area:16 | slot:24 | prevState:4
+    };
+    
+    struct Segment {
+        int64_t baseTime;       // nanoseconds
+        PackedEntry entries[ROLLBACK_SEGMENT];
+    };
+    
+    std::deque<Segment*> segments;
+    Segment* spare;             // one emptied segment kept for reuse
+    int head;                   // oldest entry's index in segments.front()
+    int count;
+    int retention;              // most entries kept; 0 = no limit
+    
+    PackedEntry& at(int i);
+    Segment* segmentOf(int i);
+    void recycle(Segment* seg);
+    void dropOldest(int n);
+    
+public:
+    RollbackManager();
+    ~RollbackManager();
+    
+    RollbackManager(const RollbackManager&) = delete;
+    RollbackManager& operator=(const RollbackManager&) = delete;
+    
+    // Whether the coordinates fit the packed layout
+    static bool canHold(const RollbackEntry& entry);
+    // Whether every slot of a zone with this many areas and slots per
+    // area does
+    static bool canAddress(int zone, int areas, int slotsPerArea);
+    // False if they do not
+    bool push(RollbackEntry& entry);
+    bool pop(RollbackEntry& entry);
+    int getSize();
+    RollbackEntry getEntry(int i);      // 0 = oldest
+    bool isEmpty();
+    
+    void setRetention(int maxEntries);
+    int getRetention();
+    
+    // Entries newest first, starting first from the top
+    void display(int first = 0, int pageSize = 10);
+};
+
+#endif
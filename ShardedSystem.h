@@ -0,0 +1,156 @@
+#ifndef SHARDEDSYSTEM_H
+#define SHARDEDSYSTEM_H
+
+#include "AllocationEngine.h"
+#include "ChunkedArray.h"
+#include "Constants.h"
+#include "ParkingRequest.h"
+#include "SpscRing.h"
+#include "Zone.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+const int SHARD_RING_SIZE = 4096;       // messages per channel
+
+enum ShardMessageType {
+    SHARD_REQUEST,      // router: a = vehicle ID, b = zone, c = tag
+    SHARD_TRANSITION,   // router: a = request ID, b = new state, c = tag
+    SHARD_RESERVE,      // a = zone (-1 = any but d), b = vehicle ID, c = pending,
+                        // d = hops (or the requested zone), e = home shard
+    SHARD_GRANT,        // a = zone, b = area, c = pending, d = slot, e = hops
+    SHARD_DENY,         // c = pending
+    SHARD_RELEASE       // a = zone, b = area, c = slot
+};
+
+struct ShardMessage {
+    int type;
+    int a, b, c, d, e;
+};
+
+struct ShardReply {
+    int tag;
+    int result;         // request ID or REQUEST_* code; 1/0 for a transition
+    BatchResult placed;
+};
+
+// ParkingSystem's allocation core split across shard threads. Zones are
+// dealt out in contiguous blocks, so most neighbours share a shard, and
+// only the owning shard ever claims or frees a zone's slots. A request
+// goes to the shard that owns its zone, which walks the zone's route
+// list. Route zones on other shards are reserved by message: RESERVE to
+// the owner, GRANT or DENY back, the walk carrying on after a DENY. When
+// the route is exhausted, each shard in turn is asked for any zone with
+// room. Shards talk over lock-free SPSC rings in shared memory, one per
+// sender/receiver pair, so no shard ever takes a lock while busy. An
+// idle shard, or a router waiting on replies, spins, yields for a
+// millisecond, then sleeps until whoever pushes to it next wakes it.
+//
+// A request lives on its home shard: request ID = local index * shards +
+// shard. Transitions go there, and a release sends the slot back to its
+// zone's owner. Vehicles are not registered and nothing is queued; a
+// request that finds no slot gets REQUEST_FULL. The router side (every
+// public call) must be used from one thread.
+class ShardedParkingSystem {
+private:
+    struct Pending {
+        int vehicleID, zone, tag;
+        int next;           // route entry to try next
+        int shardsAsked;    // once the route is done
+    };
+    
+    struct Sleeper {
+        std::mutex lock;
+        std::condition_variable wake;
+        std::atomic<bool> sleeping;     // parking or parked
+        
+        Sleeper() : sleeping(false) {}
+    };
+    
+    struct Shard {
+        int id;
+        std::vector<int> owned;                 // zone IDs, ascending
+        std::vector<uint64_t> ownedFree;        // bit i = owned[i] has a free slot
+        ChunkedArray<ParkingRequest> requests;
+        int requestCount;
+        std::vector<Pending> pending;
+        std::vector<int> freePending;
+        
+        std::vector<SpscRing<ShardMessage>*> inbox;     // [0] router, [1 + s] shard s
+        SpscRing<ShardReply>* replies;
+        std::vector<std::deque<ShardMessage>> backlog;  // per shard, while its ring is full
+        std::deque<ShardReply> replyBacklog;
+        std::vector<char> pushed;               // per shard, pushed to this pass
+        bool replied;                           // pushed a reply this pass
+        Sleeper sleep;
+        std::thread thread;
+        
+        Shard() : requestCount(0), replies(nullptr), replied(false) {}
+    };
+    
+    ChunkedArray<Zone> zones;
+    int zoneCount;
+    std::vector<int> owner;             // zone -> shard
+    std::vector<int> ownedIndex;        // zone -> index in its shard's owned list
+    AllocationEngine routes;            // route lists only
+    std::vector<Shard*> shards;
+    int shardCount;
+    std::atomic<bool> stopping;
+    std::atomic<int> flushed;           // shards with nothing left to send
+    Sleeper routerSleep;
+    std::vector<char> dispatched;       // per shard, sent to since the last collect
+    
+    void run(Shard& s);
+    bool poll(Shard& s);
+    bool flush(Shard& s);
+    void handle(Shard& s, ShardMessage& m);
+    void send(Shard& s, int to, const ShardMessage& m);
+    void reply(Shard& s, const ShardReply& r);
+    void wakePushed(Shard& s);
+    void park(Sleeper& w, Shard* s);
+    void wake(Sleeper& w);
+    
+    void advance(Shard& s, int p);
+    void finish(Shard& s, int p, int zone, int area, int slot, int hops);
+    bool claimLocal(Shard& s, int zone, int vID, int& area, int& slot);
+    void releaseLocal(Shard& s, int zone, int area, int slot);
+    int anyLocal(Shard& s, int skipZone);
+    
+    void dispatch(int shard, const ShardMessage& m);
+    void collect(std::vector<ShardReply>& out, long expected);
+
+public:
+    ShardedParkingSystem();
+    ~ShardedParkingSystem();
+    
+    ShardedParkingSystem(const ShardedParkingSystem&) = delete;
+    ShardedParkingSystem& operator=(const ShardedParkingSystem&) = delete;
+    
+    // City layout, before start()
+    int addZone(const std::string& name, int numAreas, int* areaCapacities);
+    bool addAdjacency(int fromZone, int toZone);
+    
+    bool start(int shardCountWanted);
+    void stop();
+    int getShardCount();
+    int getShardOf(int zone);
+    
+    // rIDs[i] is a request ID, REQUEST_REJECTED or REQUEST_FULL
+    void submitAll(const std::vector<BatchRequest>& batch, std::vector<int>& rIDs,
+                   std::vector<BatchResult>& placed);
+    void transitionAll(const std::vector<int>& rIDs, RequestState newState,
+                       std::vector<int>& done);
+    int submitRequest(int vID, int zone);
+    bool transitionRequest(int rID, RequestState newState);
+    
+    // Only once stopped
+    ParkingRequest* getRequest(int rID);
+    Zone* getZone(int zone);
+};
+
+#endif
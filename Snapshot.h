@@ -0,0 +1,82 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+
+// On-disk layout of a ParkingSystem snapshot. The file is a header
+// followed by flat arrays of the fixed-size records below, each section
+// starting on an 8-byte boundary, so a mapped file is read in place with
+// no parsing. Bump SNAPSHOT_VERSION whenever a record changes shape.
+
+const char SNAPSHOT_MAGIC[8] = {'P', 'K', 'S', 'N', 'A', 'P', '\0', '\0'};
+const uint32_t SNAPSHOT_VERSION = 4;
+
+enum SnapshotSectionID {
+    SNAP_ZONES,         // SnapZone
+    SNAP_AREAS,         // int32_t capacity, zone by zone
+    SNAP_ADJACENT,      // int32_t zone ID, zone by zone
+    SNAP_SLOTS,         // SnapSlot, occupied slots only
+    SNAP_VEHICLES,      // SnapVehicle, by vehicle ID
+    SNAP_REQUESTS,      // SnapRequest, by request ID
+    SNAP_WAITING,       // SnapWaiter, in arrival order
+    SNAP_ROLLBACK,      // SnapRollback, oldest first
+    SNAP_ATTRIBUTES,    // SnapSlotAttr, slots with attributes only (v4)
+    SNAP_SECTION_COUNT
+};
+
+struct SnapSection {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct SnapHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t logSequence;       // last write-ahead log frame included (v2)
+    SnapSection sections[SNAP_SECTION_COUNT];
+};
+
+struct SnapZone {
+    char name[48];
+    int32_t areaCount;
+    int32_t adjacentCount;
+    int32_t usage;
+    int32_t reserved;
+};
+
+struct SnapSlot {
+    int32_t zone, area, slot, vehicleID;
+};
+
+struct SnapSlotAttr {
+    int32_t zone, area, slot, attrs;
+};
+
+struct SnapVehicle {
+    char plate[32];
+    int32_t preferredZone;
+    int32_t needs;              // SlotAttribute bits (v4)
+};
+
+struct SnapRequest {
+    int64_t requestTime, allocationTime, releaseTime;     // TimeStamp nanoseconds (v3)
+    int32_t vehicleID, requestedZone;
+    int32_t allocatedZone, allocatedArea, allocatedSlot;
+    int32_t state;
+    float penalty;
+    int32_t reserved;
+};
+
+struct SnapWaiter {
+    int32_t vehicleID, zone;
+};
+
+struct SnapRollback {
+    int64_t time;               // TimeStamp nanoseconds (v3)
+    int32_t requestID, zone, area, slot;
+    int32_t prevState;
+    int32_t reserved;
+};
+
+#endif
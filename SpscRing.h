@@ -0,0 +1,62 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+const size_t CACHE_LINE = 64;
+
+// Bounded single-producer, single-consumer ring over shared memory.
+// Head and tail sit on their own cache lines and each side keeps a copy
+// of the other's index, so a push or pop touches the shared line only
+// when the ring looks full or empty.
+template <typename T>
+class SpscRing {
+private:
+    std::vector<T> items;
+    size_t mask;
+    
+    alignas(CACHE_LINE) std::atomic<size_t> head;   // next to pop; written by the consumer
+    size_t cachedTail;
+    alignas(CACHE_LINE) std::atomic<size_t> tail;   // next to push; written by the producer
+    size_t cachedHead;
+
+public:
+    // capacity must be a power of two
+    explicit SpscRing(size_t capacity) : items(capacity), mask(capacity - 1), 
+                                         head(0), cachedTail(0), tail(0), cachedHead(0) {}
+    
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+    
+    // Producer side. False when full.
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead == items.size()) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead == items.size()) return false;
+        }
+        items[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer side. False when empty.
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) return false;
+        }
+        item = items[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool isEmpty() {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef TESTRUNNER_H
+#define TESTRUNNER_H
+
+#include "ParkingSystem.h"
+#include <iomanip>
+
+class TestRunner {
+private:
+    bool testSlotAllocation();
+    bool testCrossZoneAllocation();
+    bool testInvalidTransition();
+    bool testCancelRequested();
+    bool testCancelAllocated();
+    bool testRollback();
+    bool testFullLifecycle();
+    bool testAnalytics();
+    bool testZoneUtilization();
+    bool testActiveRequestIndex();
+    bool testPlateIndex();
+    bool testConcurrentAllocation();
+    bool testReplay();
+    bool testWaitingQueueDrain();
+    bool testQueuePosition();
+    bool testHistoryLog();
+    bool testSnapshot();
+    bool testWriteAheadLog();
+    bool testRollbackJournal();
+    bool testNearestFirstAllocation();
+    bool testBatchAllocation();
+    bool testMinPenaltyBatch();
+    bool testTimeStamp();
+    bool testShardedSystem();
+    bool testRequestPipeline();
+    bool testHoldExpiry();
+    bool testOccupancyForecast();
+    bool testSlotAttributes();
+    
+public:
+    void runTests();
+};
+
+#endif
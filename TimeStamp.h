@@ -0,0 +1,100 @@
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+const int TIME_TEXT_SIZE = 9;       // "HH:MM:SS" and the terminator
+
+// Nanoseconds since the Unix epoch, read from the monotonic clock plus
+// one wall-clock offset taken at first use. Reading it is a vDSO call
+// with no syscall, values never go backwards, and two stamps compare and
+// subtract directly. Formatting works out the local hour once per hour
+// per thread and does the rest with arithmetic, so it is thread-safe and
+// allocation-free.
+class TimeStamp {
+private:
+    int64_t nanos;
+    
+    static int64_t epochOffset() {
+        using namespace std::chrono;
+        static const int64_t offset =
+            duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count() -
+            duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+        return offset;
+    }
+    
+    static int64_t now() {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count() +
+               epochOffset();
+    }
+    
+    // Local hour of the second sec, and the second that hour started
+    static void localHour(int64_t sec, int& hour, int64_t& hourStart) {
+        time_t t = (time_t)sec;
+        tm local;
+        #ifdef _WIN32
+            localtime_s(&local, &t);
+        #else
+            localtime_r(&t, &local);
+        #endif
+        hour = local.tm_hour;
+        hourStart = sec - local.tm_min * 60 - local.tm_sec;
+    }
+
+public:
+    TimeStamp() : nanos(now()) {}
+    
+    static TimeStamp fromNanos(int64_t ns) {
+        TimeStamp t;
+        t.nanos = ns;
+        return t;
+    }
+    static TimeStamp fromSeconds(time_t sec) { return fromNanos((int64_t)sec * 1000000000LL); }
+    
+    int64_t getNanos() const { return nanos; }
+    time_t getTime() const { return (time_t)(nanos / 1000000000LL); }
+    
+    bool operator<(const TimeStamp& other) const { return nanos < other.nanos; }
+    bool operator==(const TimeStamp& other) const { return nanos == other.nanos; }
+    
+    float getHoursDiff(const TimeStamp& other) const {
+        int64_t diff = nanos > other.nanos ? nanos - other.nanos : other.nanos - nanos;
+        return (float)(diff / 3.6e12);
+    }
+    
+    // Writes "HH:MM:SS" in local time into out[TIME_TEXT_SIZE]
+    void format(char* out) const {
+        thread_local int64_t cachedStart = INT64_MIN;
+        thread_local int cachedHour = 0;
+        int64_t sec = nanos / 1000000000LL;
+        if (sec < cachedStart || sec >= cachedStart + 3600) {
+            localHour(sec, cachedHour, cachedStart);
+        }
+        int inHour = (int)(sec - cachedStart);
+        int fields[3] = {cachedHour, inHour / 60, inHour % 60};
+        for (int f = 0; f < 3; f++) {
+            out[f * 3] = (char)('0' + fields[f] / 10);
+            out[f * 3 + 1] = (char)('0' + fields[f] % 10);
+            out[f * 3 + 2] = f < 2 ? ':' : '\0';
+        }
+    }
+    
+    void display() const {
+        char text[TIME_TEXT_SIZE];
+        format(text);
+        std::cout << text;
+    }
+    
+    std::string toString() const {
+        char text[TIME_TEXT_SIZE];
+        format(text);
+        return std::string(text);
+    }
+};
+
+#endif
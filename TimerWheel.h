@@ -0,0 +1,57 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <cstdint>
+#include <vector>
+
+const int WHEEL_BITS = 6;                       // slots per level = 64
+const int WHEEL_SLOTS = 1 << WHEEL_BITS;
+const int WHEEL_LEVELS = 6;                     // 2^36 ticks before the overflow list
+
+// Hierarchical timer wheel over integer ticks, one timer per small integer
+// ID (a request ID). Level l holds timers due in the current level-l chunk
+// of time, in 64 slots of 64^l ticks each; a timer moves one level down
+// each time its slot comes up, until it fires from level 0 on its exact
+// tick. Timers are index-linked lists, so arming and cancelling are O(1)
+// and never touch other timers. advance() jumps straight to the next
+// occupied slot with a bit scan per level, so any number of pending
+// timers cost nothing until their slot is reached.
+class TimerWheel {
+private:
+    std::vector<int> next, prev, slotOf;        // by ID; slotOf -1 = not armed
+    std::vector<int64_t> deadline;
+    int head[WHEEL_LEVELS * WHEEL_SLOTS + 1];                // level * 64 + slot, then overflow
+    uint64_t occupied[WHEEL_LEVELS];            // bit s = slot s of the level non-empty
+    int64_t current;                            // first tick not yet fired
+    int armed;
+    
+    void place(int id);
+    void unlink(int id);
+    void takeSlot(int slot, std::vector<int>& out);
+    void cascade(int slot);
+
+public:
+    explicit TimerWheel(int64_t start = 0);
+    
+    // Forgets every timer and starts the clock at start
+    void reset(int64_t start);
+    
+    // Due at tick when (a tick already past fires on the next advance).
+    // Arming an armed ID moves its timer.
+    void arm(int id, int64_t when);
+    bool cancel(int id);
+    bool isArmed(int id);
+    int64_t getDeadline(int id);        // -1 if not armed
+    int getArmedCount();
+    int64_t getCurrent();
+    // First tick at which advance() has work: a level-0 slot to fire or a
+    // higher one to cascade. Never later than the next deadline; -1 with
+    // nothing armed.
+    int64_t nextTick();
+    
+    // Fires every timer due at or before tick to, appending their IDs to
+    // expired; they are disarmed
+    void advance(int64_t to, std::vector<int>& expired);
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef VEHICLE_H
+#define VEHICLE_H
+
+#include <string>
+#include <iostream>
+
+class Vehicle {
+private:
+    int id;
+    std::string plate;
+    int preferredZone;
+    bool active;
+    
+public:
+    Vehicle();
+    
+    void init(int i, std::string p, int z);
+    
+    int getID();
+    std::string getPlate();
+    int getPreferredZone();
+    bool isActive();
+    
+    void display();
+};
+
+#endif
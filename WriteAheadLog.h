@@ -0,0 +1,90 @@
+#ifndef WRITEAHEADLOG_H
+#define WRITEAHEADLOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+enum WalOp {
+    WAL_REGISTER = 1,   // a = preferred zone, b = needs, text = plate
+    WAL_REQUEST,        // a = vehicle ID, b = zone
+    WAL_TRANSITION,     // a = request ID, b = new state
+    WAL_ROLLBACK,       // a = operation count
+    WAL_BATCH           // a = request count, b = BatchMode; the requests follow
+};
+
+// One logged operation. Frames are all the same size, so a torn write at
+// the tail is caught by its length or checksum.
+struct WalFrame {
+    uint64_t seq;
+    uint32_t op;
+    int32_t a, b;
+    char text[32];
+    uint32_t checksum;
+};
+
+// Append-only log of the operations that change ParkingSystem state.
+// Frames collect in memory and go to disk with one write and one fsync
+// per group: when groupFrames are pending, or on commit(). Recovery
+// (ParkingSystem::replayLog) re-runs the frames newer than the last
+// snapshot through the same core operations, which are deterministic
+// when run in order on one thread.
+class WriteAheadLog {
+private:
+    FILE* file;
+    std::string path;
+    std::vector<WalFrame> pending;
+    int groupFrames;
+    uint64_t nextSeq, durableSeq;
+    long fileBytes;                 // whole frames written before pending
+
+public:
+    WriteAheadLog();
+    ~WriteAheadLog();
+    
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+    
+    // Opens or creates the log, dropping any torn frames at its tail.
+    // Sequence numbers continue after both the log and afterSeq.
+    bool open(const char* logPath, uint64_t afterSeq = 0, int group = 64);
+    void close();
+    
+    // Sequence number of the new frame, or 0 if it could not be logged;
+    // a refused frame is never written later
+    uint64_t append(WalOp op, int a, int b, const char* text = nullptr);
+    // Makes every appended frame durable. On failure the file is cut back
+    // to the frames written before, and the pending ones are kept to try
+    // again; if it cannot be cut back the log closes.
+    bool commit();
+    // Empties the log once a snapshot covers all of it
+    bool reset();
+    
+    uint64_t getLastSequence();
+    uint64_t getDurableSequence();
+};
+
+// Reads a log's frames in order, stopping at the first torn or corrupt one
+class WalReader {
+private:
+    FILE* in;
+    std::vector<WalFrame> block;
+    size_t pos, count;
+    uint64_t lastSeq;
+    long validFrames;
+
+public:
+    WalReader();
+    ~WalReader();
+    
+    WalReader(const WalReader&) = delete;
+    WalReader& operator=(const WalReader&) = delete;
+    
+    bool open(const char* logPath);
+    bool next(WalFrame& frame);
+    long getValidFrames();
+    uint64_t getLastSequence();
+};
+
+#endif
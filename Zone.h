@@ -0,0 +1,66 @@
+#ifndef ZONE_H
+#define ZONE_H
+
+#include "ParkingArea.h"
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <atomic>
+
+class Zone {
+private:
+    int zoneID;
+    std::string name;
+    std::vector<ParkingArea> areas;     // sized once in init(), never reallocated
+    int areaCount;
+    std::vector<std::atomic<uint64_t>> areaMask;    // bit i set = area i may have a free slot
+    std::vector<int> adjacentZones;
+    int totalSlots;
+    std::atomic<int> availableSlots;
+    int attrsPresent;                               // every attribute some slot here has
+    std::atomic<int> freeInClass[SLOT_CLASSES];     // free slots by attributes; [0] unused
+    
+    void syncAreaBit(int areaID);
+    void countFree(int areaID, int slotID, int delta);
+    
+public:
+    Zone();
+    
+    void init(int id, std::string n, int numAreas, int* areaCapacities);
+    void addAdjacent(int zID);
+    bool hasSlots();
+    ParkingSlot* findSlot(int needs = 0);
+    void occupySlot(ParkingSlot* slot, int vID);
+    bool occupySlot(int areaID, int slotID, int vID);
+    
+    // Slot attributes (SlotAttribute flags); city layout, before use
+    bool setSlotAttributes(int areaID, int slotID, int attrs);
+    int getSlotAttributes(int areaID, int slotID);
+    int getAttributesPresent();
+    // Free slots a vehicle with these requirements fits, from per-class
+    // counters without touching any bitmap
+    int getAvailableFor(int needs);
+    bool hasSlotsFor(int needs);
+    
+    // Thread-safe and lock-free. claimSlots() only hands out slots a
+    // vehicle without requirements fits.
+    ParkingSlot* claimSlot(int vID, int needs = 0);
+    int claimSlots(int n, const int* vIDs, std::vector<ParkingSlot*>& out);
+    bool releaseSlot(int areaID, int slotID);
+    
+    int getID();
+    std::string getName();
+    int getAvailable();
+    int getTotal();
+    int getAdjacentCount();
+    int getAdjacent(int i);
+    int getAreaCount();
+    ParkingArea& getArea(int i);
+    float getOccupancyRate();
+    
+    void display();
+    void displayDetailed();
+};
+
+#endif
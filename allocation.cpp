@@ -1,52 +1,418 @@
 #include "AllocationEngine.h"
+#include "MinCostFlow.h"
+#include <algorithm>
 
-bool AllocationEngine::allocate(int reqZone, int vID, int& allocZone, int& allocArea, 
-                                int& allocSlot, float& penalty, Zone* zones, int zoneCount) {
-    // Try requested zone first
-    if (reqZone >= 0 && reqZone < zoneCount && zones[reqZone].hasSlots()) {
-        ParkingSlot* slot = zones[reqZone].findSlot();
-        if (slot) {
-            allocZone = reqZone;
-            allocArea = slot->getAreaID();
-            allocSlot = slot->getSlotID();
-            penalty = 0;
-            zones[reqZone].occupySlot(slot, vID);
-            return true;
+AllocationEngine::AllocationEngine() : fillingCount(0), routedZones(-1) {}
+
+// Same schedule as the old tiers: requested zone free, a neighbour $15,
+// anything further $25
+float AllocationEngine::penaltyFor(int hops) {
+    if (hops == 0) return 0;
+    if (hops == 1) return 15.0;
+    return 25.0;
+}
+
+void AllocationEngine::invalidateRoutes() {
+    routedZones = -1;
+}
+
+void AllocationEngine::buildRoutes(ChunkedArray<Zone>& zones, int zoneCount) {
+    routeStart.assign(zoneCount + 1, 0);
+    routeZone.clear();
+    routeHops.clear();
+    
+    // seen[z] == src marks z as queued in the search from src
+    std::vector<int> seen(zoneCount, -1);
+    std::vector<int> queue, queueHops;
+    for (int src = 0; src < zoneCount; src++) {
+        routeStart[src] = (int)routeZone.size();
+        queue.assign(1, src);
+        queueHops.assign(1, 0);
+        seen[src] = src;
+        
+        int kept = 0;
+        for (size_t head = 0; head < queue.size(); head++) {
+            int z = queue[head], hops = queueHops[head];
+            if (hops >= 2 && kept >= MAX_CANDIDATES) break;
+            routeZone.push_back(z);
+            routeHops.push_back((uint8_t)(hops < FAR_HOPS ? hops : FAR_HOPS - 1));
+            kept++;
+            
+            for (int i = 0; i < zones[z].getAdjacentCount(); i++) {
+                int adj = zones[z].getAdjacent(i);
+                if (adj >= 0 && adj < zoneCount && seen[adj] != src) {
+                    seen[adj] = src;
+                    queue.push_back(adj);
+                    queueHops.push_back(hops + 1);
+                }
+            }
         }
     }
+    routeStart[zoneCount] = (int)routeZone.size();
+    
+    zoneFree = std::vector<std::atomic<uint64_t>>(wordsFor(zoneCount));
+    for (int w = 0; w < (int)zoneFree.size(); w++) zoneFree[w] = 0;
+    for (int z = 0; z < zoneCount; z++) {
+        if (zones[z].hasSlots()) zoneFree[z / BITS_PER_WORD] |= 1ULL << (z % BITS_PER_WORD);
+    }
+    zoneFilling = std::vector<std::atomic<uint64_t>>(wordsFor(zoneCount));
+    for (int w = 0; w < (int)zoneFilling.size(); w++) zoneFilling[w] = 0;
+    fillingCount = 0;
+    routedZones = zoneCount;
+}
+
+bool AllocationEngine::isFilling(int z) {
+    return (zoneFilling[z / BITS_PER_WORD].load() >> (z % BITS_PER_WORD)) & 1;
+}
+
+void AllocationEngine::setFilling(int zone, bool filling) {
+    if (zone < 0 || zone >= routedZones) return;
+    uint64_t bit = 1ULL << (zone % BITS_PER_WORD);
+    uint64_t before = filling ? zoneFilling[zone / BITS_PER_WORD].fetch_or(bit)
+                              : zoneFilling[zone / BITS_PER_WORD].fetch_and(~bit);
+    if (filling && !(before & bit)) fillingCount++;
+    if (!filling && (before & bit)) fillingCount--;
+}
+
+int AllocationEngine::getFillingCount() { return fillingCount.load(); }
+
+// Same rule as Zone::syncAreaBit(): clear only after seeing the zone full,
+// then look again, so a racing release is never lost
+void AllocationEngine::syncZoneBit(ChunkedArray<Zone>& zones, int z) {
+    std::atomic<uint64_t>& word = zoneFree[z / BITS_PER_WORD];
+    uint64_t bit = 1ULL << (z % BITS_PER_WORD);
+    if (!zones[z].hasSlots()) {
+        word.fetch_and(~bit);
+        if (!zones[z].hasSlots()) return;
+    }
+    word.fetch_or(bit);
+}
+
+bool AllocationEngine::claimIn(ChunkedArray<Zone>& zones, int z, int vID, int hops, 
+                               int& allocArea, int& allocSlot, float& penalty, int needs) {
+    // claimSlot() takes the slot with compare-and-swap on the zone's bitmaps
+    ParkingSlot* slot = zones[z].claimSlot(vID, needs);
+    if (!zones[z].hasSlots()) syncZoneBit(zones, z);
+    if (!slot) return false;
+    allocArea = slot->getAreaID();
+    allocSlot = slot->getSlotID();
+    penalty = penaltyFor(hops);
+    return true;
+}
+
+bool AllocationEngine::allocate(int reqZone, int vID, int& allocZone, int& allocArea, 
+                                int& allocSlot, float& penalty, ChunkedArray<Zone>& zones, int zoneCount,
+                                int needs) {
+    if (routedZones != zoneCount) buildRoutes(zones, zoneCount);
     
-    // Try adjacent zones with moderate penalty
+    // Nearest first along the precomputed route; hasSlotsFor() skips full
+    // zones, and zones with nothing the vehicle fits, without touching
+    // their bitmaps. With zones marked as filling,
+    // each distance is walked twice: unmarked zones, then marked ones.
+    int passes = fillingCount.load() > 0 ? 2 : 1;
     if (reqZone >= 0 && reqZone < zoneCount) {
-        for (int i = 0; i < zones[reqZone].getAdjacentCount(); i++) {
-            int adj = zones[reqZone].getAdjacent(i);
-            if (adj >= 0 && adj < zoneCount && zones[adj].hasSlots()) {
-                ParkingSlot* slot = zones[adj].findSlot();
-                if (slot) {
-                    allocZone = adj;
-                    allocArea = slot->getAreaID();
-                    allocSlot = slot->getSlotID();
-                    penalty = 15.0;
-                    zones[adj].occupySlot(slot, vID);
-                    return true;
+        int end = routeStart[reqZone + 1];
+        for (int k = routeStart[reqZone]; k < end; ) {
+            int group = k;
+            while (group < end && routeHops[group] == routeHops[k]) group++;
+            for (int pass = 0; pass < passes; pass++) {
+                for (int j = k; j < group; j++) {
+                    int z = routeZone[j];
+                    if (passes == 2 && isFilling(z) != (pass == 1)) continue;
+                    if (zones[z].hasSlotsFor(needs) && 
+                        claimIn(zones, z, vID, routeHops[j], allocArea, allocSlot, penalty, needs)) {
+                        allocZone = z;
+                        return true;
+                    }
                 }
             }
+            k = group;
         }
     }
     
-    // Try any available zone with higher penalty
-    for (int i = 0; i < zoneCount; i++) {
-        if (i != reqZone && zones[i].hasSlots()) {
-            ParkingSlot* slot = zones[i].findSlot();
-            if (slot) {
-                allocZone = i;
-                allocArea = slot->getAreaID();
-                allocSlot = slot->getSlotID();
-                penalty = 25.0;
-                zones[i].occupySlot(slot, vID);
-                return true;
+    // Route exhausted: any zone the free-capacity bitmap still marks,
+    // unmarked zones first
+    for (int pass = 0; pass < passes; pass++) {
+        for (int w = 0; w < (int)zoneFree.size(); w++) {
+            uint64_t word = zoneFree[w].load();
+            if (passes == 2 && pass == 0) word &= ~zoneFilling[w].load();
+            while (word) {
+                int z = w * BITS_PER_WORD + lowestSetBit(word);
+                word &= word - 1;
+                if (z != reqZone && zones[z].hasSlotsFor(needs) &&
+                    claimIn(zones, z, vID, FAR_HOPS, allocArea, allocSlot, penalty, needs)) {
+                    allocZone = z;
+                    return true;
+                }
             }
         }
     }
     
     return false;
-}
\ No newline at end of file
+}
+
+bool AllocationEngine::release(ChunkedArray<Zone>& zones, int zone, int area, int slot) {
+    if (!zones[zone].releaseSlot(area, slot)) return false;
+    if (zone < routedZones) {
+        zoneFree[zone / BITS_PER_WORD].fetch_or(1ULL << (zone % BITS_PER_WORD));
+    }
+    return true;
+}
+
+void AllocationEngine::allocateBatch(const std::vector<BatchRequest>& batch, 
+                                     std::vector<BatchResult>& results,
+                                     ChunkedArray<Zone>& zones, int zoneCount,
+                                     PlanHook hook, void* context) {
+    if (routedZones != zoneCount) buildRoutes(zones, zoneCount);
+    int n = (int)batch.size();
+    results.assign(n, BatchResult{false, -1, -1, -1, 0});
+    
+    // Plan: make allocate()'s choice for each request in turn, with a
+    // free-slot counter standing in for the bitmaps. A zone's counter is
+    // only read from the zone when the batch first looks at it.
+    std::vector<int> remaining(zoneCount, -1);
+    auto roomIn = [&](int z) -> int& {
+        if (remaining[z] == -1) remaining[z] = zones[z].getAvailableFor(0);
+        return remaining[z];
+    };
+    
+    // Counters only go down while planning, so each requested zone keeps
+    // a cursor past the front of its route list that has filled up
+    std::vector<int> routeFrom(zoneCount, -1);
+    std::vector<int> planned(hook ? zoneCount : 0, 0);
+    int fallFrom = 0, steerFrom = 0;
+    for (int i = 0; i < n; i++) {
+        int reqZone = batch[i].zone, pick = -1, hops = FAR_HOPS;
+        bool steer = fillingCount.load() > 0;
+        if (reqZone >= 0 && reqZone < zoneCount) {
+            int& k = routeFrom[reqZone];
+            int end = routeStart[reqZone + 1];
+            if (k == -1) k = routeStart[reqZone];
+            while (k < end && roomIn(routeZone[k]) == 0) k++;
+            if (k < end) {
+                pick = routeZone[k];
+                hops = routeHops[k];
+            }
+            // As allocate(): an unmarked zone at the same distance first
+            for (int j = k; steer && pick != -1 && isFilling(pick) && j < end && routeHops[j] == hops; j++) {
+                if (!isFilling(routeZone[j]) && roomIn(routeZone[j]) > 0) pick = routeZone[j];
+            }
+        }
+        // Fallback, unmarked zones first: past steerFrom every unmarked
+        // zone other than reqZone is out of room for the rest of the batch
+        bool fullBelow = true;
+        for (int w = steerFrom / BITS_PER_WORD; steer && pick == -1 && w < (int)zoneFree.size(); w++) {
+            uint64_t word = zoneFree[w].load() & ~zoneFilling[w].load();
+            if (w == steerFrom / BITS_PER_WORD) word &= ~0ULL << (steerFrom % BITS_PER_WORD);
+            while (word) {
+                int z = w * BITS_PER_WORD + lowestSetBit(word);
+                word &= word - 1;
+                if (roomIn(z) == 0) {
+                    if (fullBelow) steerFrom = z + 1;
+                    continue;
+                }
+                fullBelow = false;
+                if (z != reqZone) {
+                    pick = z;
+                    break;
+                }
+            }
+        }
+        // Then the lowest zone with room, skipping zones the plan has
+        // already filled (they stay full for the rest of the batch)
+        fullBelow = true;
+        for (int w = fallFrom / BITS_PER_WORD; pick == -1 && w < (int)zoneFree.size(); w++) {
+            uint64_t word = zoneFree[w].load();
+            if (w == fallFrom / BITS_PER_WORD) word &= ~0ULL << (fallFrom % BITS_PER_WORD);
+            while (word) {
+                int z = w * BITS_PER_WORD + lowestSetBit(word);
+                word &= word - 1;
+                if (roomIn(z) == 0) {
+                    if (fullBelow) fallFrom = z + 1;
+                    continue;
+                }
+                fullBelow = false;
+                if (z != reqZone) {
+                    pick = z;
+                    break;
+                }
+            }
+        }
+        if (pick == -1) continue;
+        roomIn(pick)--;
+        results[i].zone = pick;
+        results[i].penalty = penaltyFor(hops);
+        if (hook) {
+            // A zone unmarked with room left may sit below steerFrom
+            bool wasFilling = isFilling(pick);
+            hook(context, pick, ++planned[pick]);
+            if (wasFilling && !isFilling(pick) && pick < steerFrom) steerFrom = pick;
+        }
+    }
+    
+    claimPlanned(batch, results, zones, zoneCount);
+}
+
+// Second half of a batch: results[i].zone is the planned zone, or -1.
+// Requests are bucketed by zone, keeping their order; zones are
+// independent, so buckets go in the order the plan first used them.
+void AllocationEngine::claimPlanned(const std::vector<BatchRequest>& batch, 
+                                    std::vector<BatchResult>& results,
+                                    ChunkedArray<Zone>& zones, int zoneCount) {
+    int n = (int)batch.size();
+    std::vector<int> bucketOf(zoneCount, -1), bucketStart;
+    for (int i = 0; i < n; i++) {
+        int z = results[i].zone;
+        if (z == -1) continue;
+        if (bucketOf[z] == -1) {
+            bucketOf[z] = (int)bucketStart.size();
+            bucketStart.push_back(0);
+        }
+        bucketStart[bucketOf[z]]++;
+    }
+    int planned = 0;
+    for (size_t k = 0; k < bucketStart.size(); k++) {
+        int size = bucketStart[k];
+        bucketStart[k] = planned;
+        planned += size;
+    }
+    bucketStart.push_back(planned);
+    std::vector<int> order(planned);
+    std::vector<int> fill(bucketStart.begin(), bucketStart.end() - 1);
+    for (int i = 0; i < n; i++) {
+        if (results[i].zone != -1) order[fill[bucketOf[results[i].zone]]++] = i;
+    }
+    
+    // Claim: one bulk call per zone, slots handed out lowest first exactly
+    // as successive claimSlot() calls would
+    std::vector<int> vIDs;
+    std::vector<ParkingSlot*> slots;
+    std::vector<int> missed;
+    for (size_t k = 0; k + 1 < bucketStart.size(); k++) {
+        int start = bucketStart[k], end = bucketStart[k + 1];
+        int z = results[order[start]].zone;
+        int count = end - start;
+        vIDs.resize(count);
+        for (int j = 0; j < count; j++) vIDs[j] = batch[order[start + j]].vehicleID;
+        slots.clear();
+        int got = zones[z].claimSlots(count, vIDs.data(), slots);
+        for (int j = 0; j < count; j++) {
+            BatchResult& r = results[order[start + j]];
+            if (j < got) {
+                r.allocated = true;
+                r.area = slots[j]->getAreaID();
+                r.slot = slots[j]->getSlotID();
+            } else {
+                missed.push_back(order[start + j]);
+            }
+        }
+        if (!zones[z].hasSlots()) syncZoneBit(zones, z);
+    }
+    
+    std::sort(missed.begin(), missed.end());
+    for (size_t m = 0; m < missed.size(); m++) {
+        BatchResult& r = results[missed[m]];
+        r.allocated = allocate(batch[missed[m]].zone, batch[missed[m]].vehicleID, 
+                               r.zone, r.area, r.slot, r.penalty, zones, zoneCount);
+    }
+}
+
+// Every request for the same zone with the same priority is one supply
+// node. It reaches its own zone at no cost and each neighbour at the
+// neighbour penalty; every zone beyond costs the same, so rather than an
+// edge per zone it goes through one hub that feeds all zones. Zones drain
+// to the sink up to their free slots.
+void AllocationEngine::allocateMinPenalty(const std::vector<BatchRequest>& batch, int waiting,
+                                          std::vector<BatchResult>& results,
+                                          ChunkedArray<Zone>& zones, int zoneCount) {
+    if (routedZones != zoneCount) buildRoutes(zones, zoneCount);
+    int n = (int)batch.size();
+    results.assign(n, BatchResult{false, -1, -1, -1, 0});
+    
+    // Group requests by (zone, waiting or new), members in request order
+    std::vector<int> groupOf(2 * zoneCount, -1), groupZone, groupStart;
+    for (int i = 0; i < n; i++) {
+        int z = batch[i].zone;
+        if (z < 0 || z >= zoneCount) continue;
+        int key = 2 * z + (i < waiting ? 0 : 1);
+        if (groupOf[key] == -1) {
+            groupOf[key] = (int)groupZone.size();
+            groupZone.push_back(z);
+            groupStart.push_back(0);
+        }
+        groupStart[groupOf[key]]++;
+    }
+    int groups = (int)groupZone.size(), grouped = 0;
+    for (int g = 0; g < groups; g++) {
+        int size = groupStart[g];
+        groupStart[g] = grouped;
+        grouped += size;
+    }
+    groupStart.push_back(grouped);
+    std::vector<int> members(grouped);
+    std::vector<int> fill(groupStart.begin(), groupStart.end() - 1);
+    for (int i = 0; i < n; i++) {
+        int z = batch[i].zone;
+        if (z >= 0 && z < zoneCount) members[fill[groupOf[2 * z + (i < waiting ? 0 : 1)]]++] = i;
+    }
+    
+    const int SOURCE = 0, SINK = 1, HUB = 2, ZONE0 = 3, GROUP0 = ZONE0 + zoneCount;
+    const int farCost = (int)penaltyFor(FAR_HOPS);
+    MinCostFlow flow(GROUP0 + groups);
+    std::vector<int> room(zoneCount), hubEdge(zoneCount, -1);
+    for (int z = 0; z < zoneCount; z++) {
+        room[z] = zones[z].getAvailableFor(0);
+        if (room[z] == 0) continue;
+        flow.addEdge(ZONE0 + z, SINK, room[z], 0);
+        hubEdge[z] = flow.addEdge(HUB, ZONE0 + z, grouped, 0);
+    }
+    
+    struct Route {
+        int edge, zone;
+        float penalty;
+    };
+    std::vector<Route> routes;
+    std::vector<int> routeFirst(groups + 1), farEdge(groups);
+    for (int g = 0; g < groups; g++) {
+        int size = groupStart[g + 1] - groupStart[g], z = groupZone[g];
+        bool isWaiting = members[groupStart[g]] < waiting;
+        flow.addEdge(SOURCE, GROUP0 + g, size, isWaiting ? 0 : WAITING_PRIORITY);
+        routeFirst[g] = (int)routes.size();
+        for (int k = routeStart[z]; k < routeStart[z + 1] && routeHops[k] <= 1; k++) {
+            if (room[routeZone[k]] == 0) continue;
+            float penalty = penaltyFor(routeHops[k]);
+            int e = flow.addEdge(GROUP0 + g, ZONE0 + routeZone[k], size, (int)penalty);
+            routes.push_back(Route{e, routeZone[k], penalty});
+        }
+        farEdge[g] = flow.addEdge(GROUP0 + g, HUB, size, farCost);
+    }
+    routeFirst[groups] = (int)routes.size();
+    
+    long sent = 0;
+    flow.solve(SOURCE, SINK, sent);
+    
+    // Hand each group's cheapest flow to its earliest members. Hub flow
+    // never lands in a zone the group could reach directly (that would
+    // not be optimal), so any pairing of hub units with zones is exact.
+    int hubZone = 0, hubLeft = 0;
+    for (int g = 0; g < groups; g++) {
+        int m = groupStart[g];
+        for (int r = routeFirst[g]; r < routeFirst[g + 1]; r++) {
+            for (int f = flow.getFlow(routes[r].edge); f > 0; f--, m++) {
+                results[members[m]].zone = routes[r].zone;
+                results[members[m]].penalty = routes[r].penalty;
+            }
+        }
+        for (int f = flow.getFlow(farEdge[g]); f > 0; f--, m++) {
+            while (hubLeft == 0) {
+                hubLeft = hubEdge[hubZone] == -1 ? 0 : flow.getFlow(hubEdge[hubZone]);
+                if (hubLeft == 0) hubZone++;
+            }
+            results[members[m]].zone = hubZone;
+            results[members[m]].penalty = (float)farCost;
+            if (--hubLeft == 0) hubZone++;
+        }
+    }
+    
+    claimPlanned(batch, results, zones, zoneCount);
+}
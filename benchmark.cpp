@@ -0,0 +1,620 @@
+#include "Benchmark.h"
+#include "ParkingSystem.h"
+#include "OccupancyForecaster.h"
+#include "RequestPipeline.h"
+#include "TimerWheel.h"
+#include "ShardedSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+// Counts heap allocations so each case can report allocations/op.
+// The replacements pair malloc with free, which GCC cannot see through.
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<long> heapAllocations(0);
+
+void* operator new(std::size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+typedef std::chrono::steady_clock Clock;
+
+// Median cost of reading the clock twice, subtracted from every sample
+static double clockOverheadNs = 0;
+
+static double elapsedNs(Clock::time_point start) {
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start).count() - clockOverheadNs;
+    return ns > 0 ? ns : 0;
+}
+
+Benchmark::Benchmark(FILE* outStream, int ops) : out(outStream), opsPerCase(ops),
+                                                 rng(2463534242u) {
+    std::vector<double> empty(10001);
+    clockOverheadNs = 0;
+    for (size_t i = 0; i < empty.size(); i++) {
+        Clock::time_point start = Clock::now();
+        empty[i] = elapsedNs(start);
+    }
+    std::nth_element(empty.begin(), empty.begin() + empty.size() / 2, empty.end());
+    clockOverheadNs = empty[empty.size() / 2];
+}
+
+int Benchmark::nextRandom(int bound) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (int)(rng % (unsigned)bound);
+}
+
+// Every zone gets four areas of areaSlots; zone z is adjacent to the next
+// fanout zones. Zones are filled lowest slot first, so the free slots that
+// remain sit at the far end of every bitmap.
+void Benchmark::buildCity(ChunkedArray<Zone>& zones, int zoneCount, int areaSlots,
+                          int occupancy, int fanout) {
+    int capacities[4] = {areaSlots, areaSlots, areaSlots, areaSlots};
+    zones.ensureSize(zoneCount);
+    for (int z = 0; z < zoneCount; z++) {
+        zones[z].init(z, "Bench", 4, capacities);
+        for (int f = 1; f <= fanout && f < zoneCount; f++) {
+            zones[z].addAdjacent((z + f) % zoneCount);
+        }
+        int fill = zones[z].getTotal() * occupancy / 100;
+        for (int i = 0; i < fill; i++) zones[z].claimSlot(i);
+    }
+}
+
+void Benchmark::report(const char* name, int zoneCount, int areaSlots, int occupancy,
+                       int fanout, Sample& sample) {
+    std::vector<float>& lat = sample.latencies;
+    float p50 = 0, p99 = 0;
+    if (!lat.empty()) {
+        std::nth_element(lat.begin(), lat.begin() + lat.size() / 2, lat.end());
+        p50 = lat[lat.size() / 2];
+        std::nth_element(lat.begin(), lat.begin() + lat.size() * 99 / 100, lat.end());
+        p99 = lat[lat.size() * 99 / 100];
+    }
+    fprintf(out, "%s,%d,%d,%d,%d,%ld,%.1f,%.3f,%.0f,%.0f\n", name, zoneCount, areaSlots,
+            occupancy, fanout, sample.ops, sample.totalNs / sample.ops,
+            (double)sample.allocations / sample.ops, p50, p99);
+    fflush(out);
+}
+
+void Benchmark::benchAllocate(int zoneCount, int areaSlots, int occupancy, int fanout) {
+    ChunkedArray<Zone> zones;
+    buildCity(zones, zoneCount, areaSlots, occupancy, fanout);
+    AllocationEngine engine;
+    engine.buildRoutes(zones, zoneCount);
+    Sample sample;
+    sample.latencies.reserve(opsPerCase);
+    
+    long allocsBefore = heapAllocations.load();
+    for (int i = 0; i < opsPerCase; i++) {
+        int reqZone = nextRandom(zoneCount);
+        int z, a, s;
+        float p;
+        Clock::time_point start = Clock::now();
+        bool ok = engine.allocate(reqZone, i, z, a, s, p, zones, zoneCount);
+        float ns = (float)elapsedNs(start);
+        sample.latencies.push_back(ns);
+        sample.totalNs += ns;
+        // Give the slot straight back so occupancy stays at the target
+        if (ok) engine.release(zones, z, a, s);
+    }
+    sample.ops = opsPerCase;
+    sample.allocations = heapAllocations.load() - allocsBefore;
+    report("allocate", zoneCount, areaSlots, occupancy, fanout, sample);
+}
+
+void Benchmark::benchFindSlot(int zoneCount, int areaSlots, int occupancy) {
+    ChunkedArray<Zone> zones;
+    buildCity(zones, zoneCount, areaSlots, occupancy, 0);
+    Sample sample;
+    sample.latencies.reserve(opsPerCase);
+    
+    long found = 0;
+    long allocsBefore = heapAllocations.load();
+    for (int i = 0; i < opsPerCase; i++) {
+        Zone& zone = zones[nextRandom(zoneCount)];
+        Clock::time_point start = Clock::now();
+        found += zone.findSlot() != nullptr;
+        float ns = (float)elapsedNs(start);
+        sample.latencies.push_back(ns);
+        sample.totalNs += ns;
+    }
+    sample.ops = opsPerCase;
+    sample.allocations = heapAllocations.load() - allocsBefore;
+    if (found < 0) fprintf(out, "#\n");     // keep the lookups observable
+    report("find_slot", zoneCount, areaSlots, occupancy, 0, sample);
+}
+
+void Benchmark::benchRelease(int zoneCount, int areaSlots, int occupancy) {
+    ChunkedArray<Zone> zones;
+    buildCity(zones, zoneCount, areaSlots, occupancy, 0);
+    Sample sample;
+    sample.latencies.reserve(opsPerCase);
+    
+    long allocsBefore = heapAllocations.load();
+    for (int i = 0; i < opsPerCase; i++) {
+        Zone& zone = zones[nextRandom(zoneCount)];
+        ParkingSlot* slot = zone.claimSlot(i);
+        if (!slot) continue;
+        int area = slot->getAreaID(), id = slot->getSlotID();
+        Clock::time_point start = Clock::now();
+        zone.releaseSlot(area, id);
+        float ns = (float)elapsedNs(start);
+        sample.latencies.push_back(ns);
+        sample.totalNs += ns;
+        sample.ops++;
+    }
+    sample.allocations = heapAllocations.load() - allocsBefore;
+    if (sample.ops > 0) report("release_slot", zoneCount, areaSlots, occupancy, 0, sample);
+}
+
+// Rolls back batch operations at a time on the default city
+// A burst of arrivals on a 50% full city, allocated one allocate() call
+// at a time or as one allocateBatch(). Each burst asks for four zones
+// next to each other (an event letting out), so it spills into their
+// neighbours. Latencies are per request, taken as the burst's time over
+// its size; every slot is given back between bursts.
+void Benchmark::benchBurst(int zoneCount, int areaSlots, int burst, bool batched) {
+    ChunkedArray<Zone> zones;
+    buildCity(zones, zoneCount, areaSlots, 50, 2);
+    AllocationEngine engine;
+    engine.buildRoutes(zones, zoneCount);
+    Sample sample;
+    
+    std::vector<BatchRequest> batch(burst);
+    std::vector<BatchResult> results;
+    results.reserve(burst);
+    int rounds = opsPerCase / burst > 0 ? opsPerCase / burst : 1;
+    sample.latencies.reserve(rounds);
+    
+    long allocsBefore = heapAllocations.load();
+    for (int r = 0; r < rounds; r++) {
+        int hotZone = nextRandom(zoneCount);
+        for (int i = 0; i < burst; i++) {
+            batch[i] = BatchRequest{i, (hotZone + nextRandom(4)) % zoneCount};
+        }
+        
+        Clock::time_point start = Clock::now();
+        if (batched) {
+            engine.allocateBatch(batch, results, zones, zoneCount);
+        } else {
+            results.resize(burst);
+            for (int i = 0; i < burst; i++) {
+                BatchResult& res = results[i];
+                res.allocated = engine.allocate(batch[i].zone, i, res.zone, res.area, 
+                                                res.slot, res.penalty, zones, zoneCount);
+            }
+        }
+        float ns = (float)elapsedNs(start);
+        sample.latencies.push_back(ns / burst);
+        sample.totalNs += ns;
+        
+        for (int i = 0; i < burst; i++) {
+            if (results[i].allocated) {
+                engine.release(zones, results[i].zone, results[i].area, results[i].slot);
+            }
+        }
+    }
+    sample.ops = (long)rounds * burst;
+    sample.allocations = heapAllocations.load() - allocsBefore;
+    report(batched ? "allocate_batch" : "allocate_burst", zoneCount, areaSlots, 50, 
+           burst, sample);
+}
+
+// One min-cost-flow batch over a city with 20-slot areas: half the
+// requests aim at 50 hot zones, the rest anywhere. Latencies are per
+// request, taken as the batch's time over its size.
+void Benchmark::benchMinPenalty(int zoneCount, int occupancy, int batchSize) {
+    ChunkedArray<Zone> zones;
+    buildCity(zones, zoneCount, 20, occupancy, 2);
+    AllocationEngine engine;
+    engine.buildRoutes(zones, zoneCount);
+    Sample sample;
+    
+    std::vector<BatchRequest> batch(batchSize);
+    std::vector<BatchResult> results;
+    const int rounds = 5;
+    long allocsBefore = heapAllocations.load();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < batchSize; i++) {
+            int zone = i % 2 == 0 ? nextRandom(50 < zoneCount ? 50 : zoneCount) : nextRandom(zoneCount);
+            batch[i] = BatchRequest{i, zone};
+        }
+        
+        Clock::time_point start = Clock::now();
+        engine.allocateMinPenalty(batch, 0, results, zones, zoneCount);
+        float ns = (float)elapsedNs(start);
+        sample.latencies.push_back(ns / batchSize);
+        sample.totalNs += ns;
+        
+        for (int i = 0; i < batchSize; i++) {
+            if (results[i].allocated) {
+                engine.release(zones, results[i].zone, results[i].area, results[i].slot);
+            }
+        }
+    }
+    sample.ops = (long)rounds * batchSize;
+    sample.allocations = heapAllocations.load() - allocsBefore;
+    report("allocate_min_penalty", zoneCount, 20, occupancy, batchSize, sample);
+}
+
+void Benchmark::benchRollback(int batch) {
+    Sample sample;
+    int rounds = std::max(1, opsPerCase / (batch * 10));
+    for (int r = 0; r < rounds; r++) {
+        ParkingSystem system;
+        system.setupCity();
+        for (int v = 0; v < batch; v++) {
+            system.addVehicle("B" + std::to_string(v), v % system.getZoneCount());
+            system.submitRequest(v, v % system.getZoneCount());
+        }
+        long allocsBefore = heapAllocations.load();
+        Clock::time_point start = Clock::now();
+        int done = system.rollbackOperations(batch);
+        float ns = (float)elapsedNs(start);
+        sample.allocations += heapAllocations.load() - allocsBefore;
+        sample.totalNs += ns;
+        sample.ops += done;
+        if (done > 0) sample.latencies.push_back(ns / done);
+    }
+    if (sample.ops > 0) report("rollback", 5, 0, 0, batch, sample);
+}
+
+// Latency of logging one request, fsyncing once per group frames
+void Benchmark::benchLogAppend(int group) {
+    const char* path = "bench_wal.log";
+    remove(path);
+    WriteAheadLog wal;
+    if (!wal.open(path, 0, group)) return;
+    
+    // An fsync per frame is far slower than everything else here
+    int ops = group == 1 ? std::min(opsPerCase, 2000) : opsPerCase;
+    Sample sample;
+    sample.latencies.reserve(ops);
+    long allocsBefore = heapAllocations.load();
+    for (int i = 0; i < ops; i++) {
+        Clock::time_point start = Clock::now();
+        wal.append(WAL_REQUEST, i, i % 5);
+        float ns = (float)elapsedNs(start);
+        sample.latencies.push_back(ns);
+        sample.totalNs += ns;
+    }
+    sample.ops = ops;
+    sample.allocations = heapAllocations.load() - allocsBefore;
+    wal.close();
+    remove(path);
+    report("wal_append", 0, 0, 0, group, sample);
+}
+
+// Time to replay a log of frames request/occupy/release cycles onto the
+// default city, as recovery would after a crash
+void Benchmark::benchRecovery(int frames) {
+    const char* path = "bench_recover.log";
+    remove(path);
+    {
+        ParkingSystem system;
+        system.setupCity();
+        WriteAheadLog wal;
+        if (!wal.open(path, 0, 4096)) return;
+        system.attachLog(&wal);
+        system.setGroupCommit(true);    // one fsync per 4096 frames, not per operation
+        int vehicles = 200;
+        for (int v = 0; v < vehicles; v++) {
+            system.addVehicle("R" + std::to_string(v), v % system.getZoneCount());
+        }
+        for (int i = vehicles; i < frames; i += 3) {
+            int v = (i / 3) % vehicles;
+            int rID = system.submitRequest(v, v % system.getZoneCount());
+            if (rID < 0) continue;
+            system.transitionRequest(rID, OCCUPIED);
+            system.transitionRequest(rID, RELEASED);
+        }
+        wal.close();
+    }
+    
+    ParkingSystem recovered;
+    recovered.setupCity();
+    long allocsBefore = heapAllocations.load();
+    Clock::time_point start = Clock::now();
+    long applied = recovered.replayLog(path);
+    Sample sample;
+    sample.totalNs = elapsedNs(start);
+    sample.allocations = heapAllocations.load() - allocsBefore;
+    sample.ops = applied;
+    remove(path);
+    if (applied > 0) report("wal_recover", 5, 0, 0, 0, sample);
+}
+
+// Reading the clock, then formatting stamps a few seconds apart as the
+// history and rollback screens do
+void Benchmark::benchTimeStamp() {
+    Sample now, format;
+    now.latencies.reserve(opsPerCase);
+    format.latencies.reserve(opsPerCase);
+    int64_t sum = 0;
+    char text[TIME_TEXT_SIZE];
+    
+    long allocsBefore = heapAllocations.load();
+    for (int i = 0; i < opsPerCase; i++) {
+        Clock::time_point start = Clock::now();
+        TimeStamp t;
+        float ns = (float)elapsedNs(start);
+        sum += t.getNanos();
+        now.latencies.push_back(ns);
+        now.totalNs += ns;
+    }
+    now.ops = opsPerCase;
+    now.allocations = heapAllocations.load() - allocsBefore;
+    
+    TimeStamp base;
+    allocsBefore = heapAllocations.load();
+    for (int i = 0; i < opsPerCase; i++) {
+        TimeStamp t = TimeStamp::fromNanos(base.getNanos() + (int64_t)i * 3000000000LL);
+        Clock::time_point start = Clock::now();
+        t.format(text);
+        float ns = (float)elapsedNs(start);
+        sum += text[7];
+        format.latencies.push_back(ns);
+        format.totalNs += ns;
+    }
+    format.ops = opsPerCase;
+    format.allocations = heapAllocations.load() - allocsBefore;
+    
+    if (sum == 0) fprintf(out, "#\n");      // keep the results observable
+    report("timestamp_now", 0, 0, 0, 0, now);
+    report("timestamp_format", 0, 0, 0, 0, format);
+}
+
+// Rounds of 8192 requests for random zones, each followed by cancelling
+// every request placed, through a ShardedParkingSystem. Latencies are per
+// request and cancel, taken as the round's time over its operations.
+void Benchmark::benchSharded(int zoneCount, int shards) {
+    ShardedParkingSystem city;
+    int capacities[4] = {20, 20, 20, 20};
+    for (int z = 0; z < zoneCount; z++) city.addZone("Bench", 4, capacities);
+    for (int z = 0; z < zoneCount; z++) city.addAdjacency(z, (z + 1) % zoneCount);
+    city.start(shards);
+    Sample sample;
+    
+    const int burst = 8192;
+    std::vector<BatchRequest> batch(burst);
+    std::vector<int> rIDs, done;
+    std::vector<BatchResult> placed;
+    int rounds = opsPerCase / burst > 0 ? opsPerCase / burst : 1;
+    long allocsBefore = heapAllocations.load();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < burst; i++) batch[i] = BatchRequest{i, nextRandom(zoneCount)};
+        Clock::time_point start = Clock::now();
+        city.submitAll(batch, rIDs, placed);
+        city.transitionAll(rIDs, CANCELLED, done);
+        float ns = (float)elapsedNs(start);
+        sample.latencies.push_back(ns / (2 * burst));
+        sample.totalNs += ns;
+    }
+    city.stop();
+    sample.ops = (long)rounds * 2 * burst;
+    sample.allocations = heapAllocations.load() - allocsBefore;
+    report("sharded", zoneCount, 20, 0, shards, sample);
+}
+
+// Producer threads post arrivals into a RequestPipeline as fast as it
+// takes them. pipeline_post is the time a terminal spends in post();
+// pipeline_e2e is post to completion, from the pipeline's histogram.
+void Benchmark::benchPipeline(int producers) {
+    ParkingSystem system;
+    int capacities[4] = {200, 200, 200, 200};
+    for (int z = 0; z < 100; z++) system.addZone("Bench", 4, capacities);
+    int perProducer = opsPerCase / producers;
+    for (int v = 0; v < perProducer * producers; v++) {
+        system.addVehicle("B" + std::to_string(v), v % 100);
+    }
+    
+    RequestPipeline pipeline(system);
+    pipeline.start();
+    std::vector<std::vector<float>> postNs(producers);
+    long allocsBefore = heapAllocations.load();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < producers; t++) {
+        threads.push_back(std::thread([&, t]() {
+            std::vector<float>& lat = postNs[t];
+            lat.reserve(perProducer);
+            for (int i = 0; i < perProducer; i++) {
+                int vID = t * perProducer + i;
+                Clock::time_point start = Clock::now();
+                while (!pipeline.post(PIPE_SUBMIT, vID, vID % 100, nullptr, nullptr)) {
+                    std::this_thread::yield();
+                }
+                lat.push_back((float)elapsedNs(start));
+            }
+        }));
+    }
+    for (int t = 0; t < producers; t++) threads[t].join();
+    pipeline.stop();
+    
+    Sample post;
+    for (int t = 0; t < producers; t++) {
+        for (size_t i = 0; i < postNs[t].size(); i++) {
+            post.latencies.push_back(postNs[t][i]);
+            post.totalNs += postNs[t][i];
+        }
+    }
+    post.ops = (long)post.latencies.size();
+    post.allocations = heapAllocations.load() - allocsBefore;
+    report("pipeline_post", 100, 200, 0, producers, post);
+    
+    LatencyHistogram& h = pipeline.getLatency();
+    fprintf(out, "pipeline_e2e,100,200,0,%d,%llu,,,%llu,%llu\n", producers,
+            (unsigned long long)h.getCount(), (unsigned long long)h.percentile(50),
+            (unsigned long long)h.percentile(99));
+    fflush(out);
+}
+
+// Hold timers in millisecond ticks, on a wheel already holding pending
+// timers due hours out: arm a timer due within ten minutes, cancel half of
+// them, then sweep the ten minutes in 100 ms steps. Expiry latencies are
+// per timer fired, taken as the step's time over the timers it fired.
+void Benchmark::benchHoldTimers(int pending) {
+    TimerWheel wheel(0);
+    for (int id = 0; id < pending; id++) {
+        wheel.arm(opsPerCase + id, 3600000 + (int64_t)nextRandom(20 * 3600) * 1000);
+    }
+    Sample arm, cancel, expire;
+    arm.latencies.reserve(opsPerCase);
+    cancel.latencies.reserve(opsPerCase / 2);
+    expire.latencies.reserve(opsPerCase);
+    
+    long allocsBefore = heapAllocations.load();
+    for (int id = 0; id < opsPerCase; id++) {
+        int64_t when = 1 + nextRandom(600000);
+        Clock::time_point start = Clock::now();
+        wheel.arm(id, when);
+        float ns = (float)elapsedNs(start);
+        arm.latencies.push_back(ns);
+        arm.totalNs += ns;
+    }
+    arm.ops = opsPerCase;
+    arm.allocations = heapAllocations.load() - allocsBefore;
+    
+    allocsBefore = heapAllocations.load();
+    for (int id = 0; id < opsPerCase; id += 2) {
+        Clock::time_point start = Clock::now();
+        wheel.cancel(id);
+        float ns = (float)elapsedNs(start);
+        cancel.latencies.push_back(ns);
+        cancel.totalNs += ns;
+    }
+    cancel.ops = (long)cancel.latencies.size();
+    cancel.allocations = heapAllocations.load() - allocsBefore;
+    
+    std::vector<int> fired;
+    fired.reserve(opsPerCase);
+    allocsBefore = heapAllocations.load();
+    for (int64_t to = 100; to <= 600000; to += 100) {
+        size_t before = fired.size();
+        Clock::time_point start = Clock::now();
+        wheel.advance(to, fired);
+        double ns = elapsedNs(start);
+        size_t n = fired.size() - before;
+        for (size_t k = 0; k < n; k++) expire.latencies.push_back((float)(ns / n));
+        expire.totalNs += ns;
+    }
+    expire.ops = (long)fired.size();
+    expire.allocations = heapAllocations.load() - allocsBefore;
+    
+    report("hold_arm", 0, 0, 0, pending, arm);
+    report("hold_cancel", 0, 0, 0, pending, cancel);
+    report("hold_expire", 0, 0, 0, pending, expire);
+}
+
+// Slot claims and frees fed to the forecaster at random zones, a few a
+// millisecond so buckets keep closing, then whole-city forecasts
+void Benchmark::benchForecast(int zoneCount) {
+    ChunkedArray<Zone> zones;
+    buildCity(zones, zoneCount, 20, 50, 2);
+    OccupancyForecaster forecaster;
+    for (int z = 0; z < zoneCount; z++) forecaster.addZone();
+    Sample record, query;
+    record.latencies.reserve(opsPerCase);
+    int64_t base = TimeStamp().getNanos();
+    
+    long allocsBefore = heapAllocations.load();
+    for (int i = 0; i < opsPerCase; i++) {
+        int z = nextRandom(zoneCount);
+        TimeStamp when = TimeStamp::fromNanos(base + (int64_t)i * 250000);
+        Clock::time_point start = Clock::now();
+        if (i & 1) forecaster.recordDeparture(z, when);
+        else forecaster.recordArrival(z, when);
+        float ns = (float)elapsedNs(start);
+        record.latencies.push_back(ns);
+        record.totalNs += ns;
+    }
+    record.ops = opsPerCase;
+    record.allocations = heapAllocations.load() - allocsBefore;
+    
+    int queries = opsPerCase / zoneCount + 1;
+    std::vector<float> rates(zoneCount);
+    TimeStamp now = TimeStamp::fromNanos(base + (int64_t)opsPerCase * 250000);
+    double sum = 0;
+    query.latencies.reserve(queries);
+    allocsBefore = heapAllocations.load();
+    for (int i = 0; i < queries; i++) {
+        Clock::time_point start = Clock::now();
+        forecaster.forecast(zones, zoneCount, FORECAST_HORIZON, rates, now);
+        float ns = (float)elapsedNs(start);
+        sum += rates[i % zoneCount];
+        query.latencies.push_back(ns);
+        query.totalNs += ns;
+    }
+    query.ops = queries;
+    query.allocations = heapAllocations.load() - allocsBefore;
+    
+    if (sum < 0) fprintf(out, "#\n");      // keep the results observable
+    report("forecast_record", zoneCount, 20, 50, 0, record);
+    report("forecast_query", zoneCount, 20, 50, 0, query);
+}
+
+void Benchmark::runAll() {
+    fprintf(out, "case,zones,area_slots,occupancy,fanout,ops,ns_per_op,"
+                 "allocs_per_op,p50_ns,p99_ns\n");
+    
+    const int zoneCounts[] = {5, 100, 1000, 5000};
+    const int areaSizes[] = {20, 200};
+    const int occupancies[] = {0, 50, 99};
+    const int fanouts[] = {2, 8};
+    
+    for (int zc : zoneCounts) {
+        for (int as : areaSizes) {
+            for (int occ : occupancies) {
+                for (int fo : fanouts) benchAllocate(zc, as, occ, fo);
+                benchFindSlot(zc, as, occ);
+                benchRelease(zc, as, occ);
+            }
+        }
+    }
+    
+    for (int zc : zoneCounts) {
+        for (int burst : {64, 1024}) {
+            benchBurst(zc, 20, burst, false);
+            benchBurst(zc, 20, burst, true);
+        }
+    }
+    
+    benchMinPenalty(100, 50, 1000);
+    benchMinPenalty(1000, 50, 10000);
+    benchMinPenalty(1000, 90, 10000);
+    
+    benchRollback(10);
+    benchRollback(100);
+    
+    benchLogAppend(1);
+    benchLogAppend(64);
+    benchLogAppend(1024);
+    benchRecovery(100000);
+    
+    benchTimeStamp();
+    
+    for (int shards : {1, 2, 4, 8}) benchSharded(1024, shards);
+    for (int producers : {1, 4}) benchPipeline(producers);
+    for (int pending : {0, 1000000}) benchHoldTimers(pending);
+    for (int zoneCount : {64, 1024}) benchForecast(zoneCount);
+}
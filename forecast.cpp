@@ -0,0 +1,76 @@
+#include "OccupancyForecaster.h"
+#include <cmath>
+
+static const float MINUTES_PER_BUCKET = FORECAST_BUCKET_SECONDS / 60.0f;
+
+int64_t OccupancyForecaster::bucketOf(TimeStamp when) {
+    return when.getNanos() / (FORECAST_BUCKET_SECONDS * 1000000000LL);
+}
+
+// Closes the buckets before bucket: the one counted folds in with weight
+// FORECAST_ALPHA, each empty one after it decays the rates once more
+void OccupancyForecaster::roll(ZoneRates& r, int64_t bucket) {
+    if (bucket <= r.bucket) return;
+    r.arrivalRate += FORECAST_ALPHA * (r.arrivals - r.arrivalRate);
+    r.departureRate += FORECAST_ALPHA * (r.departures - r.departureRate);
+    int64_t empty = bucket - r.bucket - 1;
+    if (empty > 0) {
+        float keep = empty < 1000 ? std::pow(1.0f - FORECAST_ALPHA, (float)empty) : 0.0f;
+        r.arrivalRate *= keep;
+        r.departureRate *= keep;
+    }
+    r.arrivals = 0;
+    r.departures = 0;
+    r.bucket = bucket;
+}
+
+void OccupancyForecaster::addZone() {
+    zones.push_back(ZoneRates());
+}
+
+void OccupancyForecaster::recordArrival(int zone, TimeStamp when) {
+    if (zone < 0 || zone >= (int)zones.size()) return;
+    ZoneRates& r = zones[zone];
+    roll(r, bucketOf(when));
+    r.arrivals++;
+}
+
+void OccupancyForecaster::recordDeparture(int zone, TimeStamp when) {
+    if (zone < 0 || zone >= (int)zones.size()) return;
+    ZoneRates& r = zones[zone];
+    roll(r, bucketOf(when));
+    r.departures++;
+}
+
+// Queries roll a copy, so reading never changes what is recorded
+float OccupancyForecaster::getArrivalRate(int zone, TimeStamp now) {
+    ZoneRates r = zones[zone];
+    roll(r, bucketOf(now));
+    return r.arrivalRate / MINUTES_PER_BUCKET;
+}
+
+float OccupancyForecaster::getDepartureRate(int zone, TimeStamp now) {
+    ZoneRates r = zones[zone];
+    roll(r, bucketOf(now));
+    return r.departureRate / MINUTES_PER_BUCKET;
+}
+
+float OccupancyForecaster::predict(int zone, int occupied, int capacity, int minutes,
+                                   TimeStamp now) {
+    ZoneRates r = zones[zone];
+    roll(r, bucketOf(now));
+    float expected = occupied + (r.arrivalRate - r.departureRate) / MINUTES_PER_BUCKET * minutes;
+    if (expected < 0) return 0;
+    return expected > capacity ? (float)capacity : expected;
+}
+
+void OccupancyForecaster::forecast(ChunkedArray<Zone>& zoneData, int zoneCount, int minutes,
+                                   std::vector<float>& rates, TimeStamp now) {
+    rates.assign(zoneCount, 0);
+    for (int z = 0; z < zoneCount && z < (int)zones.size(); z++) {
+        int total = zoneData[z].getTotal();
+        if (total == 0) continue;
+        int occupied = total - zoneData[z].getAvailable();
+        rates[z] = predict(z, occupied, total, minutes, now) / total;
+    }
+}
@@ -0,0 +1,78 @@
+#include "HistoryLog.h"
+#include "TimeStamp.h"
+
+HistoryLog::HistoryLog() : count(0), sealedCount(0) {}
+
+HistoryLog::~HistoryLog() {
+    for (size_t i = 0; i < segments.size(); i++) delete segments[i];
+}
+
+void HistoryLog::append(int rID, int vID, int reqZone, int allocZone,
+                        RequestState state, float penalty) {
+    if (sealedCount == (int)segments.size()) {
+        segments.push_back(new Segment);
+        segments.back()->size = 0;
+    }
+    
+    Segment* seg = segments.back();
+    int i = seg->size++;
+    seg->requestID[i] = rID;
+    seg->vehicleID[i] = vID;
+    seg->requestedZone[i] = reqZone;
+    seg->allocatedZone[i] = allocZone;
+    seg->state[i] = (uint8_t)state;
+    seg->penalty[i] = penalty;
+    seg->time[i] = TimeStamp().getNanos();
+    count++;
+    
+    if (seg->size == HISTORY_SEGMENT) sealedCount++;
+}
+
+void HistoryLog::seal() {
+    if (sealedCount < (int)segments.size()) sealedCount++;
+}
+
+long HistoryLog::getCount() { return count; }
+int HistoryLog::getSegmentCount() { return (int)segments.size(); }
+int HistoryLog::getSealedCount() { return sealedCount; }
+
+long HistoryLog::countState(RequestState state) {
+    long total = 0;
+    uint8_t s = (uint8_t)state;
+    for (size_t k = 0; k < segments.size(); k++) {
+        const uint8_t* col = segments[k]->state;
+        int n = segments[k]->size;
+        int hits = 0;
+        for (int i = 0; i < n; i++) hits += (col[i] == s);
+        total += hits;
+    }
+    return total;
+}
+
+double HistoryLog::sumPenalty(RequestState state) {
+    double total = 0;
+    uint8_t s = (uint8_t)state;
+    for (size_t k = 0; k < segments.size(); k++) {
+        const uint8_t* states = segments[k]->state;
+        const float* pen = segments[k]->penalty;
+        int n = segments[k]->size;
+        float sum = 0;
+        for (int i = 0; i < n; i++) sum += (states[i] == s) ? pen[i] : 0.0f;
+        total += sum;
+    }
+    return total;
+}
+
+bool HistoryLog::writeSegment(int seg, FILE* out) {
+    if (seg < 0 || seg >= sealedCount) return false;
+    Segment* s = segments[seg];
+    size_t n = (size_t)s->size;
+    return fwrite(&s->size, sizeof(s->size), 1, out) == 1 &&
+           fwrite(s->requestID, sizeof(int32_t), n, out) == n &&
+           fwrite(s->vehicleID, sizeof(int32_t), n, out) == n &&
+           fwrite(s->requestedZone, sizeof(int32_t), n, out) == n &&
+           fwrite(s->allocatedZone, sizeof(int32_t), n, out) == n &&
+           fwrite(s->state, sizeof(uint8_t), n, out) == n &&
+           fwrite(s->penalty, sizeof(float), n, out) == n &&
+           fwrite(s->time, sizeof(int64_t), n, out) == n;
+}
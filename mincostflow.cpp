@@ -0,0 +1,110 @@
+#include "MinCostFlow.h"
+#include <climits>
+#include <functional>
+#include <queue>
+#include <utility>
+
+static const long UNREACHED = LONG_MAX / 4;
+
+MinCostFlow::MinCostFlow(int nodes) : nodeCount(nodes) {}
+
+int MinCostFlow::addEdge(int from, int to, int cap, int cost) {
+    edges.push_back(Edge{from, to, cap, cost});
+    edges.push_back(Edge{to, from, 0, -cost});
+    return (int)edges.size() - 2;
+}
+
+int MinCostFlow::getFlow(int edge) {
+    return edges[edge ^ 1].cap;
+}
+
+long MinCostFlow::reducedCost(int e) {
+    return edges[e].cost + potential[edges[e].from] - potential[edges[e].to];
+}
+
+// Dijkstra on reduced costs, then folds the distances into the potentials
+// so every edge on a shortest path ends up with reduced cost zero
+bool MinCostFlow::shortestPaths(int s, int t) {
+    typedef std::pair<long, int> Item;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+    dist.assign(nodeCount, UNREACHED);
+    dist[s] = 0;
+    heap.push(Item(0, s));
+    while (!heap.empty()) {
+        Item top = heap.top();
+        heap.pop();
+        int u = top.second;
+        if (top.first > dist[u]) continue;
+        for (int i = start[u]; i < start[u + 1]; i++) {
+            int e = order[i];
+            if (edges[e].cap == 0) continue;
+            long d = dist[u] + reducedCost(e);
+            if (d < dist[edges[e].to]) {
+                dist[edges[e].to] = d;
+                heap.push(Item(d, edges[e].to));
+            }
+        }
+    }
+    if (dist[t] == UNREACHED) return false;
+    for (int v = 0; v < nodeCount; v++) {
+        potential[v] += dist[v] < dist[t] ? dist[v] : dist[t];
+    }
+    return true;
+}
+
+// BFS levels over the residual edges with zero reduced cost
+bool MinCostFlow::buildLevels(int s, int t) {
+    level.assign(nodeCount, -1);
+    std::vector<int> queue(1, s);
+    level[s] = 0;
+    for (size_t head = 0; head < queue.size(); head++) {
+        int u = queue[head];
+        for (int i = start[u]; i < start[u + 1]; i++) {
+            int e = order[i], v = edges[e].to;
+            if (edges[e].cap > 0 && level[v] == -1 && reducedCost(e) == 0) {
+                level[v] = level[u] + 1;
+                queue.push_back(v);
+            }
+        }
+    }
+    return level[t] != -1;
+}
+
+int MinCostFlow::push(int u, int t, int limit) {
+    if (u == t) return limit;
+    for (int& i = next[u]; i < start[u + 1]; i++) {
+        int e = order[i], v = edges[e].to;
+        if (edges[e].cap == 0 || level[v] != level[u] + 1 || reducedCost(e) != 0) continue;
+        int sent = push(v, t, limit < edges[e].cap ? limit : edges[e].cap);
+        if (sent > 0) {
+            edges[e].cap -= sent;
+            edges[e ^ 1].cap += sent;
+            return sent;
+        }
+    }
+    return 0;
+}
+
+long MinCostFlow::solve(int s, int t, long& flow) {
+    // Group edge indices by their from node
+    start.assign(nodeCount + 1, 0);
+    for (size_t e = 0; e < edges.size(); e++) start[edges[e].from + 1]++;
+    for (int v = 0; v < nodeCount; v++) start[v + 1] += start[v];
+    order.resize(edges.size());
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    for (size_t e = 0; e < edges.size(); e++) order[fill[edges[e].from]++] = (int)e;
+    
+    potential.assign(nodeCount, 0);
+    flow = 0;
+    long cost = 0;
+    while (shortestPaths(s, t)) {
+        while (buildLevels(s, t)) {
+            next.assign(start.begin(), start.end() - 1);
+            while (int sent = push(s, t, INT_MAX)) {
+                flow += sent;
+                cost += (long)sent * (potential[t] - potential[s]);
+            }
+        }
+    }
+    return cost;
+}
@@ -1,10 +1,11 @@
 #include "ParkingRequest.h"
+#include "RequestStats.h"
 
 ParkingRequest::ParkingRequest() : requestID(-1), vehicleID(-1), requestedZone(-1),
                                    allocatedZone(-1), allocatedArea(-1), allocatedSlot(-1),
-                                   state(REQUESTED), penalty(0) {}
+                                   state(REQUESTED), penalty(0), stats(nullptr) {}
 
-void ParkingRequest::init(int rID, int vID, int zone) {
+void ParkingRequest::init(int rID, int vID, int zone, RequestStats* s) {
     requestID = rID;
     vehicleID = vID;
     requestedZone = zone;
@@ -14,6 +15,7 @@ void ParkingRequest::init(int rID, int vID, int zone) {
     state = REQUESTED;
     penalty = 0;
     requestTime = TimeStamp();
+    stats = s;
 }
 
 bool ParkingRequest::canTransition(RequestState newState) {
@@ -30,6 +32,7 @@ bool ParkingRequest::changeState(RequestState newState) {
     if (newState == RELEASED || newState == CANCELLED) releaseTime = TimeStamp();
     
     state = newState;
+    if (stats) stats->record(*this, 1);
     return true;
 }
 
@@ -49,7 +52,23 @@ int ParkingRequest::getAllocatedSlot() { return allocatedSlot; }
 RequestState ParkingRequest::getState() { return state; }
 float ParkingRequest::getPenalty() { return penalty; }
 
-void ParkingRequest::setState(RequestState s) { state = s; }
+void ParkingRequest::setState(RequestState s) {
+    if (stats) stats->record(*this, -1);
+    state = s;
+    if (stats) stats->record(*this, 1);
+}
+
+void ParkingRequest::restore(RequestState s, TimeStamp req, TimeStamp alloc, TimeStamp rel) {
+    state = s;
+    requestTime = req;
+    allocationTime = alloc;
+    releaseTime = rel;
+    if (stats) stats->record(*this, 1);
+}
+
+TimeStamp ParkingRequest::getRequestTime() { return requestTime; }
+TimeStamp ParkingRequest::getAllocationTime() { return allocationTime; }
+TimeStamp ParkingRequest::getReleaseTime() { return releaseTime; }
 
 bool ParkingRequest::isCrossZone() { 
     return allocatedZone != requestedZone && allocatedZone != -1; 
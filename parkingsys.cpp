@@ -1,7 +1,10 @@
 #include "ParkingSystem.h"
 #include "Constants.h"
+#include "Bitmap.h"
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <cstring>
 #include <limits>
 #include <sstream>
 
@@ -47,115 +50,205 @@ string getString(string prompt) {
     return value;
 }
 
-// RequestHistory class (Linked List)
-class RequestHistory {
+// WaitingQueue class
+// FIFO of vehicles that found no slot. Waiters live in a node pool linked
+// by index, so enqueue and dequeue never allocate once the pool has grown
+// to the peak queue length. Each waiter is also linked into a lane: a FIFO
+// for the zone it asked for and its requirements, so a release in one zone
+// only looks at the waiters that zone can actually help, and a waiter no
+// free slot suits never holds up those behind it with other requirements.
+class WaitingQueue {
 private:
     struct Node {
-        ParkingRequest req;
-        Node* next;
-        
-        Node(ParkingRequest& r) : req(r), next(nullptr) {}
+        int vehicleID, zone, needs;
+        long seq;           // global enqueue order
+        long zoneSeq;       // enqueue order within lane
+        TimeStamp addedTime;
+        int next, prev;     // global FIFO
+        int zoneNext;       // lane FIFO
     };
     
-    Node* head;
-    int count;
-    
-public:
-    RequestHistory() : head(nullptr), count(0) {}
+    // Waiters only ever leave from the front of their lane, so a waiter's
+    // place in line is zoneSeq - left + 1
+    struct Lane {
+        int front, rear;
+        long joined, left;
+        Lane() : front(-1), rear(-1), joined(0), left(0) {}
+    };
     
-    ~RequestHistory() {
-        while (head) {
-            Node* temp = head;
-            head = head->next;
-            delete temp;
+    vector<Node> pool;
+    int freeList;           // unused nodes, chained through next
+    int front, rear;
+    int size;
+    long nextSeq;
+    
+    // Per zone: the lane of waiters without requirements, and which
+    // requirement lanes have waiters (bit = needs). Those lanes are few,
+    // so they are made on demand.
+    vector<Lane> zoneLanes;
+    vector<int> zoneNeeds;
+    vector<Lane> needsLanes;
+    IntHashIndex needsLaneOf;   // zone * SLOT_CLASSES + needs -> needsLanes index
+    
+    IntHashIndex byVehicle;     // vehicle ID -> node
+    
+    int allocNode() {
+        if (freeList == -1) {
+            int oldSize = (int)pool.size();
+            pool.resize(oldSize == 0 ? 64 : oldSize * 2);
+            for (int i = (int)pool.size() - 1; i >= oldSize; i--) {
+                pool[i].next = freeList;
+                freeList = i;
+            }
         }
+        int n = freeList;
+        freeList = pool[n].next;
+        return n;
+    }
+    
+    Lane* findLane(int zone, int needs) {
+        if (zone < 0 || zone >= (int)zoneLanes.size()) return nullptr;
+        if (needs == 0) return &zoneLanes[zone];
+        int l = needsLaneOf.get(zone * SLOT_CLASSES + needs);
+        return l == -1 ? nullptr : &needsLanes[l];
     }
     
-    void add(ParkingRequest& req) {
-        Node* newNode = new Node(req);
-        newNode->next = head;
-        head = newNode;
-        count++;
+    Lane& makeLane(int zone, int needs) {
+        if (zone >= (int)zoneLanes.size()) {
+            zoneLanes.resize(zone + 1);
+            zoneNeeds.resize(zone + 1, 0);
+        }
+        Lane* lane = findLane(zone, needs);
+        if (lane) return *lane;
+        needsLaneOf.put(zone * SLOT_CLASSES + needs, (int)needsLanes.size());
+        needsLanes.push_back(Lane());
+        return needsLanes.back();
     }
     
-    void getStats(int& completed, int& cancelled, int& crossZone, float& avgDuration) {
-        completed = 0;
-        cancelled = 0;
-        crossZone = 0;
-        float totalDuration = 0;
+    // Unlinks n, which must be the front of its lane
+    void remove(int n) {
+        Node& node = pool[n];
+        if (node.prev != -1) pool[node.prev].next = node.next;
+        else front = node.next;
+        if (node.next != -1) pool[node.next].prev = node.prev;
+        else rear = node.prev;
         
-        Node* curr = head;
-        while (curr) {
-            if (curr->req.getState() == RELEASED) {
-                completed++;
-                totalDuration += curr->req.getDuration();
-                if (curr->req.isCrossZone()) crossZone++;
-            } else if (curr->req.getState() == CANCELLED) {
-                cancelled++;
-            }
-            curr = curr->next;
+        Lane& lane = *findLane(node.zone, node.needs);
+        lane.front = node.zoneNext;
+        if (node.zoneNext == -1) {
+            lane.rear = -1;
+            zoneNeeds[node.zone] &= ~(1 << node.needs);
         }
+        lane.left++;
         
-        avgDuration = (completed > 0) ? totalDuration / completed : 0;
+        byVehicle.erase(node.vehicleID);
+        node.next = freeList;
+        freeList = n;
+        size--;
     }
     
-    int getCount() { return count; }
-};
-
-// WaitingQueue class
-class WaitingQueue {
-private:
-    struct Node {
-        int vehicleID, zone;
-        TimeStamp addedTime;
-        Node* next;
-        Node(int v, int z) : vehicleID(v), zone(z), next(nullptr) {}
-    };
+public:
+    WaitingQueue() : freeList(-1), front(-1), rear(-1), size(0), nextSeq(0) {}
     
-    Node* front;
-    Node* rear;
-    int size;
+    // False if the vehicle is already waiting
+    bool enqueue(int vID, int zone, int needs = 0) {
+        if (byVehicle.get(vID) != -1) return false;
+        Lane& lane = makeLane(zone, needs);
+        
+        int n = allocNode();
+        Node& node = pool[n];
+        node.vehicleID = vID;
+        node.zone = zone;
+        node.needs = needs;
+        node.seq = nextSeq++;
+        node.zoneSeq = lane.joined++;
+        node.addedTime = TimeStamp();
+        node.next = -1;
+        node.prev = rear;
+        node.zoneNext = -1;
+        
+        if (rear == -1) front = n;
+        else pool[rear].next = n;
+        rear = n;
+        
+        if (lane.rear == -1) lane.front = n;
+        else pool[lane.rear].zoneNext = n;
+        lane.rear = n;
+        zoneNeeds[zone] |= 1 << needs;
+        
+        byVehicle.put(vID, n);
+        size++;
+        return true;
+    }
     
-public:
-    WaitingQueue() : front(nullptr), rear(nullptr), size(0) {}
+    bool dequeue(int& vID, int& zone) {
+        if (front == -1) return false;
+        
+        vID = pool[front].vehicleID;
+        zone = pool[front].zone;
+        remove(front);
+        return true;
+    }
     
-    ~WaitingQueue() {
-        while (front) {
-            Node* temp = front;
-            front = front->next;
-            delete temp;
+    // Oldest waiter whose lane (zone * SLOT_CLASSES + needs) is not in
+    // passed. Lanes keep global order, so it is the front of its lane.
+    bool peek(const vector<int>& passed, int& vID, int& zone, int& needs) {
+        for (int n = front; n != -1; n = pool[n].next) {
+            const Node& node = pool[n];
+            if (std::find(passed.begin(), passed.end(), node.zone * SLOT_CLASSES + node.needs) != passed.end()) {
+                continue;
+            }
+            vID = node.vehicleID;
+            zone = node.zone;
+            needs = node.needs;
+            return true;
         }
+        return false;
     }
     
-    void enqueue(int vID, int zone) {
-        Node* node = new Node(vID, zone);
-        if (!rear) {
-            front = rear = node;
-        } else {
-            rear->next = node;
-            rear = node;
-        }
-        size++;
+    // Requirement sets (bit = needs) with someone waiting for zone
+    int getZoneNeeds(int zone) {
+        return zone < (int)zoneNeeds.size() ? zoneNeeds[zone] : 0;
     }
     
-    bool dequeue(int& vID, int& zone) {
-        if (!front) return false;
-        
-        vID = front->vehicleID;
-        zone = front->zone;
-        
-        Node* temp = front;
-        front = front->next;
-        if (!front) rear = nullptr;
-        
-        delete temp;
-        size--;
+    // Oldest waiter that asked for zone with these requirements; seq
+    // orders waiters across lanes
+    bool peekZone(int zone, int needs, int& vID, long& seq) {
+        Lane* lane = findLane(zone, needs);
+        if (!lane || lane->front == -1) return false;
+        vID = pool[lane->front].vehicleID;
+        seq = pool[lane->front].seq;
+        return true;
+    }
+    
+    bool dequeueZone(int zone, int needs, int& vID) {
+        Lane* lane = findLane(zone, needs);
+        if (!lane || lane->front == -1) return false;
+        vID = pool[lane->front].vehicleID;
+        remove(lane->front);
         return true;
     }
     
+    // 1-based place in line among the waiters for the same zone with the
+    // same requirements, or 0
+    int getPosition(int vID, int& zone) {
+        int n = byVehicle.get(vID);
+        if (n == -1) return 0;
+        zone = pool[n].zone;
+        return (int)(pool[n].zoneSeq - findLane(zone, pool[n].needs)->left + 1);
+    }
+    
     int getSize() { return size; }
     bool isEmpty() { return size == 0; }
     
+    // Waiters in arrival order
+    void list(vector<int>& vIDs, vector<int>& zones) {
+        for (int n = front; n != -1; n = pool[n].next) {
+            vIDs.push_back(pool[n].vehicleID);
+            zones.push_back(pool[n].zone);
+        }
+    }
+    
     void display() {
         if (size == 0) {
             cout << "Waiting Queue: Empty\n";
@@ -164,57 +257,604 @@ public:
         
         cout << "Waiting Queue (" << size << " vehicles):\n";
         printLine();
-        Node* curr = front;
         int pos = 1;
-        while (curr) {
-            cout << pos++ << ". Vehicle ID: " << curr->vehicleID 
-                 << " | Zone: " << curr->zone 
-                 << " | Added: " << curr->addedTime.toString() << "\n";
-            curr = curr->next;
+        for (int n = front; n != -1 && pos <= 10; n = pool[n].next) {
+            cout << pos++ << ". Vehicle ID: " << pool[n].vehicleID 
+                 << " | Zone: " << pool[n].zone 
+                 << " (#" << (pool[n].zoneSeq - findLane(pool[n].zone, pool[n].needs)->left + 1) 
+                 << " in zone)"
+                 << " | Added: " << pool[n].addedTime.toString() << "\n";
+        }
+        if (size > 10) {
+            cout << "... and " << (size - 10) << " more vehicles\n";
         }
     }
 };
 
 // ParkingSystem implementation
-ParkingSystem::ParkingSystem() : zoneCount(0), vehicleCount(0), requestCount(0),
-                                 completed(0), cancelled(0) {
-    for (int i = 0; i < MAX_ZONES; i++) zoneUsage[i] = 0;
-    history = new RequestHistory();
+// Hold timers tick in milliseconds of TimeStamp
+static const int64_t HOLD_TICK_NS = 1000000;
+
+ParkingSystem::ParkingSystem() : zoneCount(0), vehicleCount(0), attributedSlots(0), 
+                                 requestCount(0),
+                                 wal(nullptr), logSequence(0), groupCommit(false), opDepth(0),
+                                 holdTimers(TimeStamp().getNanos() / HOLD_TICK_NS),
+                                 holdTimeout(0), forecastHorizon(0) {
     waitQueue = new WaitingQueue();
 }
 
 ParkingSystem::~ParkingSystem() {
-    delete history;
     delete waitQueue;
 }
 
-void ParkingSystem::initCity() {
-    clearScreen();
-    cout << "CITY PARKING SYSTEM INITIALIZATION\n";
-    printLine();
-    
-    cout << "\nInitializing city infrastructure...\n";
-    
-    zoneCount = 5;
-    
+// ==================== CORE OPERATIONS ====================
+// No console I/O below this point until the interactive screens; the
+// menu and the headless ReplayEngine both drive the system through these.
+
+int ParkingSystem::addZone(const std::string& name, int numAreas, int* areaCapacities) {
+    // Every allocation is journalled for rollback, so a zone the journal
+    // cannot address is refused rather than left unable to undo
+    int widest = 0;
+    for (int a = 0; a < numAreas; a++) widest = std::max(widest, areaCapacities[a]);
+    if (!RollbackManager::canAddress(zoneCount, numAreas, widest)) return -1;
+    zones.ensureSize(zoneCount + 1);
+    zones[zoneCount].init(zoneCount, name, numAreas, areaCapacities);
+    zoneUsage.push_back(0);
+    stats.addZone();
+    forecaster.addZone();
+    allocEngine.invalidateRoutes();
+    return zoneCount++;
+}
+
+bool ParkingSystem::addAdjacency(int fromZone, int toZone) {
+    if (fromZone < 0 || fromZone >= zoneCount || toZone < 0 || toZone >= zoneCount) {
+        return false;
+    }
+    zones[fromZone].addAdjacent(toZone);
+    allocEngine.invalidateRoutes();
+    if (toZone >= (int)adjacentFrom.size()) adjacentFrom.resize(toZone + 1);
+    adjacentFrom[toZone].push_back(fromZone);
+    return true;
+}
+
+void ParkingSystem::setupCity() {
     int downtown[] = {10, 8, 6};
     int commercial[] = {12, 10, 8, 6};
     int residential[] = {10, 8, 6, 4};
     int industrial[] = {8, 6};
     int suburban[] = {10, 8, 6};
     
-    zones[0].init(0, "Downtown", 3, downtown);
-    zones[1].init(1, "Commercial", 4, commercial);
-    zones[2].init(2, "Residential", 4, residential);
-    zones[3].init(3, "Industrial", 2, industrial);
-    zones[4].init(4, "Suburban", 3, suburban);
+    addZone("Downtown", 3, downtown);
+    addZone("Commercial", 4, commercial);
+    addZone("Residential", 4, residential);
+    addZone("Industrial", 2, industrial);
+    addZone("Suburban", 3, suburban);
     
     // Set adjacencies
-    zones[0].addAdjacent(1); zones[0].addAdjacent(2);
-    zones[1].addAdjacent(0); zones[1].addAdjacent(2);
-    zones[2].addAdjacent(0); zones[2].addAdjacent(1); zones[2].addAdjacent(3);
-    zones[3].addAdjacent(2); zones[3].addAdjacent(4);
-    zones[4].addAdjacent(3);
+    addAdjacency(0, 1); addAdjacency(0, 2);
+    addAdjacency(1, 0); addAdjacency(1, 2);
+    addAdjacency(2, 0); addAdjacency(2, 1); addAdjacency(2, 3);
+    addAdjacency(3, 2); addAdjacency(3, 4);
+    addAdjacency(4, 3);
+    
+    allocEngine.buildRoutes(zones, zoneCount);
+}
+
+int ParkingSystem::addVehicle(const std::string& plate, int preferredZone, int needs) {
+    LogCommit scope(*this);
+    if (preferredZone < 0 || preferredZone >= zoneCount) return -1;
+    if (needs < 0 || needs >= SLOT_CLASSES) return -1;
+    if (!logOp(WAL_REGISTER, preferredZone, needs, plate.c_str())) return -1;
+    if (!plateIndex.insert(plate, vehicleCount)) return -1;
+    
+    vehicles.ensureSize(vehicleCount + 1);
+    vehicles[vehicleCount].init(vehicleCount, plate, preferredZone);
+    vehicleNeeds.push_back(needs);
+    return vehicleCount++;
+}
+
+int ParkingSystem::getVehicleNeeds(int vID) {
+    if (vID < 0 || vID >= vehicleCount) return 0;
+    return vehicleNeeds[vID];
+}
+
+bool ParkingSystem::setSlotAttributes(int zone, int area, int slot, int attrs) {
+    if (zone < 0 || zone >= zoneCount) return false;
+    if (area < 0 || area >= zones[zone].getAreaCount()) return false;
+    if (slot < 0 || slot >= zones[zone].getArea(area).getTotal()) return false;
+    int old = zones[zone].getSlotAttributes(area, slot);
+    if (!zones[zone].setSlotAttributes(area, slot, attrs)) return false;
+    attributedSlots += (attrs != 0) - (old != 0);
+    return true;
+}
+
+int ParkingSystem::submitRequest(int vID, int zone) {
+    LogCommit scope(*this);
+    servedFromQueue.clear();
+    if (!logOp(WAL_REQUEST, vID, zone)) return REQUEST_REJECTED;
+    int rID = createRequest(vID, zone);
+    if (rID == REQUEST_QUEUED) waitQueue->enqueue(vID, zone, vehicleNeeds[vID]);
+    return rID;
+}
+
+// Validates and allocates; leaves queueing to the caller
+int ParkingSystem::createRequest(int vID, int zone) {
+    if (vID < 0 || vID >= vehicleCount || zone < 0 || zone >= zoneCount) {
+        return REQUEST_REJECTED;
+    }
+    if (findActiveRequest(vID) != -1) return REQUEST_REJECTED;
+    
+    // Try to allocate
+    int allocZone, allocArea, allocSlot;
+    float penalty = 0;
+    
+    if (!allocate(zone, vID, allocZone, allocArea, allocSlot, penalty)) {
+        return REQUEST_QUEUED;
+    }
+    return recordAllocation(vID, zone, allocZone, allocArea, allocSlot, penalty);
+}
+
+// Creates the request for a slot already claimed and records it
+int ParkingSystem::recordAllocation(int vID, int zone, int allocZone, int allocArea, 
+                                    int allocSlot, float penalty) {
+    requests.ensureSize(requestCount + 1);
+    requests[requestCount].init(requestCount, vID, zone, &stats);
+    requests[requestCount].setAllocation(allocZone, allocArea, allocSlot, penalty);
+    requests[requestCount].changeState(ALLOCATED);
+    syncActiveIndex(requestCount);
+    
+    // Save for rollback; addZone() made sure the entry fits
+    RollbackEntry entry(requestCount, allocZone, allocArea, allocSlot, REQUESTED);
+    rollbackMgr.push(entry);
+    
+    history.append(requestCount, vID, zone, allocZone, ALLOCATED, penalty);
+    zoneUsage[allocZone]++;
+    TimeStamp now = requests[requestCount].getAllocationTime();
+    forecaster.recordArrival(allocZone, now);
+    steer(allocZone, now);
+    
+    return requestCount++;
+}
+
+// Burst arrivals: the whole batch is validated and logged, then allocated
+// with one engine call. In order, results match submitRequest() on each
+// in turn. For least penalty the waiting queue joins the batch, ahead of
+// it, and waiters placed are served first; the log then gets a WAL_BATCH
+// frame before the requests so replay repeats the batch as a whole.
+// A vehicle listed twice (or already waiting) only reaches the engine
+// once; its later entries are rejected if it got a slot and queued
+// (again) if it did not.
+void ParkingSystem::submitBatch(const std::vector<BatchRequest>& batch, 
+                                std::vector<int>& results, BatchMode mode) {
+    LogCommit scope(*this);
+    servedFromQueue.clear();
+    int n = (int)batch.size();
+    results.assign(n, REQUEST_REJECTED);
+    if (mode == BATCH_MIN_PENALTY && !logOp(WAL_BATCH, n, mode)) return;
+    
+    std::vector<BatchRequest> toAllocate;
+    std::vector<int> owner;             // toAllocate index -> batch index, -1 = waiter
+    std::vector<int> first(n, -1);      // batch index -> its toAllocate index
+    IntHashIndex seen;                  // vehicle ID -> toAllocate index
+    int waiting = 0;
+    if (mode == BATCH_MIN_PENALTY) {
+        std::vector<int> vIDs, zoneIDs;
+        listWaiting(vIDs, zoneIDs);
+        // Waiters with requirements are in lanes of their own, left for
+        // serveWaiting()
+        for (size_t w = 0; w < vIDs.size(); w++) {
+            if (vehicleNeeds[vIDs[w]] != 0) continue;
+            seen.put(vIDs[w], (int)toAllocate.size());
+            toAllocate.push_back(BatchRequest{vIDs[w], zoneIDs[w]});
+            owner.push_back(-1);
+        }
+        waiting = (int)toAllocate.size();
+    }
+    toAllocate.reserve(waiting + n);
+    
+    // Places toAllocate, which holds the waiters and then the plain
+    // vehicles of batch[from, to)
+    auto place = [&](int from, int to) {
+        std::vector<BatchResult> allocated;
+        if (mode == BATCH_MIN_PENALTY) {
+            allocEngine.allocateMinPenalty(toAllocate, waiting, allocated, zones, zoneCount);
+        } else {
+            allocEngine.allocateBatch(toAllocate, allocated, zones, zoneCount, 
+                                      forecastHorizon ? steerPlanned : nullptr, this);
+        }
+        
+        // Waiters placed are always the front of their zone's lane, as the
+        // engine gives a zone's slots to its earliest requests
+        for (int w = 0; w < waiting; w++) {
+            const BatchResult& r = allocated[w];
+            if (!r.allocated) continue;
+            int vID = toAllocate[w].vehicleID;
+            waitQueue->dequeueZone(toAllocate[w].zone, 0, vID);
+            servedFromQueue.push_back(recordAllocation(vID, toAllocate[w].zone, 
+                                                       r.zone, r.area, r.slot, r.penalty));
+        }
+        
+        for (int i = from; i < to; i++) {
+            if (first[i] == -1) continue;
+            const BatchResult& r = allocated[first[i]];
+            if (owner[first[i]] != i) {
+                results[i] = r.allocated ? REQUEST_REJECTED : REQUEST_QUEUED;
+            } else if (r.allocated) {
+                results[i] = recordAllocation(batch[i].vehicleID, batch[i].zone, 
+                                              r.zone, r.area, r.slot, r.penalty);
+            } else {
+                results[i] = REQUEST_QUEUED;
+                waitQueue->enqueue(batch[i].vehicleID, batch[i].zone);
+            }
+        }
+        toAllocate.clear();
+        owner.clear();
+        seen.clear();
+        waiting = 0;
+    };
+    
+    int runStart = 0;
+    for (int i = 0; i < n; i++) {
+        int vID = batch[i].vehicleID, zone = batch[i].zone;
+        if (!logOp(WAL_REQUEST, vID, zone)) continue;
+        if (vID < 0 || vID >= vehicleCount || zone < 0 || zone >= zoneCount) continue;
+        if (findActiveRequest(vID) != -1) continue;
+        // Vehicles with requirements have the fewest slots to choose
+        // from: they are placed one at a time. For least penalty, ahead
+        // of the rest; in order, once the plain vehicles before them are.
+        if (vehicleNeeds[vID] != 0) {
+            if (mode == BATCH_IN_ORDER && !toAllocate.empty()) {
+                place(runStart, i);
+                runStart = i;
+            }
+            results[i] = createRequest(vID, zone);
+            if (results[i] == REQUEST_QUEUED) waitQueue->enqueue(vID, zone, vehicleNeeds[vID]);
+            continue;
+        }
+        first[i] = seen.get(vID);
+        if (first[i] != -1) continue;
+        seen.put(vID, (int)toAllocate.size());
+        first[i] = (int)toAllocate.size();
+        toAllocate.push_back(batch[i]);
+        owner.push_back(i);
+    }
+    place(runStart, n);
+}
+
+// A slot just came free in zone: give it to the oldest waiter that asked
+// for zone or for a zone adjacent to it. Those zones' lanes are looked at
+// first. With none of them waiting, or none suited, the oldest other
+// waiter gets it, as allocate() would place them anywhere with a penalty.
+// A waiter the slot does not suit leaves its lane passed over, and the
+// next oldest is tried; once every lane is passed, nothing more fits.
+void ParkingSystem::serveWaiting(int zone) {
+    std::vector<int> passed;        // zone * SLOT_CLASSES + needs
+    while (!waitQueue->isEmpty()) {
+        int vID = -1, reqZone = -1, needs = 0;
+        long bestSeq = 0;
+        auto consider = [&](int from) {
+            for (int lanes = waitQueue->getZoneNeeds(from); lanes; lanes &= lanes - 1) {
+                int c = lowestSetBit((uint64_t)lanes), waiter;
+                long seq;
+                if (std::find(passed.begin(), passed.end(), from * SLOT_CLASSES + c) != passed.end()) {
+                    continue;
+                }
+                if (waitQueue->peekZone(from, c, waiter, seq) && (reqZone == -1 || seq < bestSeq)) {
+                    vID = waiter;
+                    reqZone = from;
+                    needs = c;
+                    bestSeq = seq;
+                }
+            }
+        };
+        consider(zone);
+        if (zone < (int)adjacentFrom.size()) {
+            for (size_t i = 0; i < adjacentFrom[zone].size(); i++) consider(adjacentFrom[zone][i]);
+        }
+        if (reqZone == -1 && !waitQueue->peek(passed, vID, reqZone, needs)) return;
+        
+        int rID = createRequest(vID, reqZone);
+        if (rID == REQUEST_QUEUED) {
+            // With no attributes anywhere, a plain car that finds nothing
+            // means nobody will
+            if (attributedSlots == 0 && needs == 0) return;
+            passed.push_back(reqZone * SLOT_CLASSES + needs);
+            continue;
+        }
+        waitQueue->dequeueZone(reqZone, needs, vID);
+        if (rID >= 0) {
+            servedFromQueue.push_back(rID);
+            return;
+        }
+        // Rejected (vehicle parked since it queued): drop it, try the next
+    }
+}
+
+void ParkingSystem::logState(int rID) {
+    ParkingRequest& req = requests[rID];
+    history.append(rID, req.getVehicleID(), req.getRequestedZone(),
+                   req.getAllocatedZone(), req.getState(), req.getPenalty());
+}
+
+void ParkingSystem::listWaiting(std::vector<int>& vIDs, std::vector<int>& zones) {
+    waitQueue->list(vIDs, zones);
+}
+
+bool ParkingSystem::addWaiting(int vID, int zone) {
+    if (vID < 0 || vID >= vehicleCount) return false;
+    return waitQueue->enqueue(vID, zone, vehicleNeeds[vID]);
+}
+
+int ParkingSystem::getQueuePosition(int vID, int& zone) {
+    return waitQueue->getPosition(vID, zone);
+}
+
+const std::vector<int>& ParkingSystem::getServedFromQueue() {
+    return servedFromQueue;
+}
+
+bool ParkingSystem::transitionRequest(int rID, RequestState newState) {
+    LogCommit scope(*this);
+    servedFromQueue.clear();
+    if (rID < 0 || rID >= requestCount || !isClientTransition(newState)) return false;
+    if (!logOp(WAL_TRANSITION, rID, newState)) return false;
+    RequestState oldState = requests[rID].getState();
+    if (!requests[rID].changeState(newState)) return false;
+    syncActiveIndex(rID);
+    logState(rID);
+    
+    // Only a request that holds a slot gives one back
+    if ((oldState == ALLOCATED || oldState == OCCUPIED) &&
+        (newState == RELEASED || newState == CANCELLED)) {
+        int zone = requests[rID].getAllocatedZone();
+        bool freed = allocEngine.release(zones, zone,
+            requests[rID].getAllocatedArea(),
+            requests[rID].getAllocatedSlot()
+        );
+        if (freed) {
+            forecaster.recordDeparture(zone, requests[rID].getReleaseTime());
+            steer(zone, requests[rID].getReleaseTime());
+            serveWaiting(zone);
+        }
+    }
+    return true;
+}
+
+// Undoes the last k allocations as one unit: take them all off the
+// journal, give back the slots, then bring states, counters and indices
+// in line. Only a request that still holds its slot gives it back; a
+// released or cancelled one already did, and the slot may be someone
+// else's by now.
+int ParkingSystem::rollbackOperations(int k, std::vector<int>* rolledBack) {
+    LogCommit scope(*this);
+    servedFromQueue.clear();
+    if (!logOp(WAL_ROLLBACK, k, 0)) return 0;
+    
+    std::vector<RollbackEntry> undo;
+    RollbackEntry entry;
+    while ((int)undo.size() < k && rollbackMgr.pop(entry)) undo.push_back(entry);
+    
+    std::vector<RollbackEntry> toFree;
+    for (size_t i = 0; i < undo.size(); i++) {
+        RequestState state = requests[undo[i].requestID].getState();
+        if (state == ALLOCATED || state == OCCUPIED) toFree.push_back(undo[i]);
+        zoneUsage[undo[i].zone]--;
+    }
+    
+    // Grouped by zone and area, so each bitmap is walked once in order
+    // rather than hit at random
+    std::sort(toFree.begin(), toFree.end(), [](const RollbackEntry& a, const RollbackEntry& b) {
+        if (a.zone != b.zone) return a.zone < b.zone;
+        if (a.area != b.area) return a.area < b.area;
+        return a.slot < b.slot;
+    });
+    std::vector<int> freedZones;
+    TimeStamp now;
+    for (size_t i = 0; i < toFree.size(); i++) {
+        if (allocEngine.release(zones, toFree[i].zone, toFree[i].area, toFree[i].slot)) {
+            freedZones.push_back(toFree[i].zone);
+            forecaster.recordDeparture(toFree[i].zone, now);
+            steer(toFree[i].zone, now);
+        }
+    }
+    
+    // setState() takes terminal requests back out of the analytics totals
+    for (size_t i = 0; i < undo.size(); i++) {
+        int rID = undo[i].requestID;
+        requests[rID].setState(undo[i].prevState);
+        syncActiveIndex(rID);
+        logState(rID);
+        if (rolledBack) rolledBack->push_back(rID);
+    }
+    
+    // Waiters are served only once the whole rollback has been applied,
+    // so their new allocations land on top of the rollback stack
+    for (size_t i = 0; i < freedZones.size(); i++) {
+        serveWaiting(freedZones[i]);
+    }
+    return (int)undo.size();
+}
+
+void ParkingSystem::setRollbackRetention(int maxEntries) {
+    rollbackMgr.setRetention(maxEntries);
+}
+
+void ParkingSystem::setHoldTimeout(int seconds) {
+    holdTimeout = seconds > 0 ? seconds : 0;
+    holdTimers.reset(TimeStamp().getNanos() / HOLD_TICK_NS);
+    for (int r = 0; r < requestCount; r++) syncHoldTimer(r);
+}
+
+int ParkingSystem::getHoldTimeout() { return holdTimeout; }
+
+void ParkingSystem::setForecastHorizon(int minutes) {
+    forecastHorizon = minutes > 0 ? minutes : 0;
+    for (int z = 0; z < zoneCount; z++) allocEngine.setFilling(z, false);
+    refreshForecast();
+}
+
+int ParkingSystem::getForecastHorizon() { return forecastHorizon; }
+OccupancyForecaster& ParkingSystem::getForecaster() { return forecaster; }
+
+void ParkingSystem::refreshForecast(TimeStamp now) {
+    for (int z = 0; z < zoneCount; z++) steer(z, now);
+}
+
+void ParkingSystem::forecastOccupancy(int minutes, std::vector<float>& rates, TimeStamp now) {
+    forecaster.forecast(zones, zoneCount, minutes, rates, now);
+}
+
+// Marks zone for the engine when it is forecast to fill within the horizon
+void ParkingSystem::steer(int zone, TimeStamp now, int planned) {
+    if (forecastHorizon == 0) return;
+    int total = zones[zone].getTotal();
+    int occupied = total - zones[zone].getAvailable() + planned;
+    float expected = forecaster.predict(zone, occupied, total, forecastHorizon, now);
+    allocEngine.setFilling(zone, total > 0 && expected >= FILLING_THRESHOLD * total);
+}
+
+// In-order batches re-steer as they are planned, as recordAllocation()
+// would after each request submitted in turn
+void ParkingSystem::steerPlanned(void* context, int zone, int planned) {
+    static_cast<ParkingSystem*>(context)->steer(zone, TimeStamp(), planned);
+}
+int ParkingSystem::getHoldCount() { return holdTimers.getArmedCount(); }
+
+int64_t ParkingSystem::nextHoldCheck() {
+    int64_t tick = holdTimers.nextTick();
+    return tick < 0 ? -1 : tick * HOLD_TICK_NS;
+}
+
+// Holds due by now come off the wheel in one advance and are cancelled
+// in turn. One whose cancellation could not be logged is armed again to
+// be retried next time.
+int ParkingSystem::expireHolds(TimeStamp now, std::vector<int>* expired) {
+    LogCommit scope(*this);
+    std::vector<int> due, served;
+    int64_t tick = now.getNanos() / HOLD_TICK_NS;
+    holdTimers.advance(tick, due);
+    if (due.empty()) return 0;
+    int cancelled = 0;
+    for (size_t i = 0; i < due.size(); i++) {
+        if (!transitionRequest(due[i], CANCELLED)) {
+            holdTimers.arm(due[i], tick);
+            continue;
+        }
+        served.insert(served.end(), servedFromQueue.begin(), servedFromQueue.end());
+        if (expired) expired->push_back(due[i]);
+        cancelled++;
+    }
+    servedFromQueue.swap(served);
+    return cancelled;
+}
+
+// Logged ahead of the change it describes; a failed write refuses the change
+bool ParkingSystem::logOp(WalOp op, int a, int b, const char* text) {
+    if (!wal) return true;
+    uint64_t seq = wal->append(op, a, b, text);
+    if (seq == 0) return false;
+    logSequence = seq;
+    return true;
+}
+
+void ParkingSystem::attachLog(WriteAheadLog* log) {
+    wal = log;
+}
+
+void ParkingSystem::setGroupCommit(bool on) {
+    groupCommit = on;
+}
+
+long ParkingSystem::replayLog(const char* path) {
+    WalReader reader;
+    if (!reader.open(path)) return -1;
+    
+    WriteAheadLog* attached = wal;
+    wal = nullptr;                  // replayed operations are already logged
+    long applied = 0;
+    WalFrame frame;
+    std::vector<BatchRequest> batch;
+    std::vector<int> results;
+    int batchLeft = 0;
+    BatchMode batchMode = BATCH_IN_ORDER;
+    while (reader.next(frame)) {
+        if (frame.seq <= logSequence) continue;     // covered by the snapshot
+        
+        // A batch's requests follow its WAL_BATCH frame. One cut short by
+        // a failed write holds the requests that made it to the log.
+        if (batchLeft > 0 && frame.op == WAL_REQUEST) {
+            batch.push_back(BatchRequest{frame.a, frame.b});
+            if (--batchLeft == 0) submitBatch(batch, results, batchMode);
+            logSequence = frame.seq;
+            applied++;
+            continue;
+        }
+        if (batchLeft > 0) {
+            batchLeft = 0;
+            submitBatch(batch, results, batchMode);
+        }
+        
+        switch (frame.op) {
+            case WAL_REGISTER:
+                addVehicle(std::string(frame.text, strnlen(frame.text, sizeof(frame.text))), 
+                           frame.a, frame.b);
+                break;
+            case WAL_REQUEST: submitRequest(frame.a, frame.b); break;
+            case WAL_TRANSITION: transitionRequest(frame.a, (RequestState)frame.b); break;
+            case WAL_ROLLBACK: rollbackOperations(frame.a); break;
+            case WAL_BATCH:
+                batch.clear();
+                batchLeft = frame.a;
+                batchMode = (BatchMode)frame.b;
+                if (batchLeft == 0) submitBatch(batch, results, batchMode);
+                break;
+        }
+        logSequence = frame.seq;
+        applied++;
+    }
+    if (batchLeft > 0) submitBatch(batch, results, batchMode);
+    wal = attached;
+    return applied;
+}
+
+// Snapshot first, then empty the log: a crash in between leaves frames
+// the snapshot already covers, which replayLog() skips by sequence
+bool ParkingSystem::checkpoint(const char* snapshotPath) {
+    if (wal && !wal->commit()) return false;
+    if (!saveSnapshot(snapshotPath)) return false;
+    return !wal || wal->reset();
+}
+
+uint64_t ParkingSystem::getLogSequence() { return logSequence; }
+
+ParkingRequest* ParkingSystem::getRequest(int rID) {
+    if (rID < 0 || rID >= requestCount) return nullptr;
+    return &requests[rID];
+}
+
+Zone* ParkingSystem::getZone(int zone) {
+    return zone >= 0 && zone < zoneCount ? &zones[zone] : nullptr;
+}
+
+RequestStats& ParkingSystem::getStats() { return stats; }
+int ParkingSystem::getZoneUsage(int zone) { return zoneUsage[zone]; }
+HistoryLog& ParkingSystem::getHistory() { return history; }
+
+int ParkingSystem::getZoneCount() { return zoneCount; }
+int ParkingSystem::getVehicleCount() { return vehicleCount; }
+int ParkingSystem::getRequestCount() { return requestCount; }
+int ParkingSystem::getActiveCount() { return activeByVehicle.size(); }
+
+// ==================== INTERACTIVE SCREENS ====================
+
+void ParkingSystem::initCity() {
+    clearScreen();
+    cout << "CITY PARKING SYSTEM INITIALIZATION\n";
+    printLine();
+    
+    cout << "\nInitializing city infrastructure...\n";
+    
+    setupCity();
     
     cout << "\nCity initialized successfully with " << zoneCount << " zones!\n\n";
     printLine();
@@ -232,13 +872,22 @@ void ParkingSystem::registerVehicle() {
     cout << "VEHICLE REGISTRATION\n";
     printLine();
     
-    if (vehicleCount >= MAX_VEHICLES) {
-        cout << "Error: Maximum vehicle limit reached!\n";
+    string plate = getString("Enter License Plate: ");
+    
+    int existing = plateIndex.find(plate);
+    if (existing != -1) {
+        cout << "\nError: This license plate is already registered!\n";
+        vehicles[existing].display();
+        pause();
+        return;
+    }
+    PlateKey key;
+    if (!key.set(plate.c_str())) {
+        cout << "\nError: Invalid license plate (1-" << PLATE_KEY_CHARS
+             << " letters or digits)!\n";
         pause();
         return;
     }
-    
-    string plate = getString("Enter License Plate: ");
     
     cout << "\nAvailable Zones:\n";
     for (int i = 0; i < zoneCount; i++) {
@@ -248,14 +897,21 @@ void ParkingSystem::registerVehicle() {
     
     int zone = getInt("\nSelect Preferred Zone (0-" + to_string(zoneCount - 1) + "): ", 
                     0, zoneCount - 1);
+    int needs = getInt("Requirements (0 none, 1 EV, 2 accessible, 4 compact, 8 oversize; "
+                       "add to combine): ", 0, SLOT_CLASSES - 1);
     
-    vehicles[vehicleCount].init(vehicleCount, plate, zone);
-    vehicleCount++;
+    int vID = addVehicle(plate, zone, needs);
+    if (vID < 0) {
+        cout << "\nError: Vehicle could not be registered!\n";
+        pause();
+        return;
+    }
     
     cout << "\nVehicle registered successfully!\n";
-    cout << "Vehicle ID: " << (vehicleCount - 1) << "\n";
+    cout << "Vehicle ID: " << vID << "\n";
     cout << "License Plate: " << plate << "\n";
     cout << "Preferred Zone: " << zones[zone].getName() << "\n";
+    if (needs != 0) cout << "Requirements: " << needs << "\n";
     
     pause();
 }
@@ -281,15 +937,12 @@ void ParkingSystem::requestParking() {
                     0, vehicleCount - 1);
     
     // Check for active parking
-    for (int i = 0; i < requestCount; i++) {
-        if (requests[i].getVehicleID() == vID &&
-            (requests[i].getState() == ALLOCATED || 
-             requests[i].getState() == OCCUPIED)) {
-            cout << "\nError: This vehicle already has an active parking allocation!\n";
-            requests[i].display();
-            pause();
-            return;
-        }
+    int activeID = findActiveRequest(vID);
+    if (activeID != -1) {
+        cout << "\nError: This vehicle already has an active parking allocation!\n";
+        requests[activeID].display();
+        pause();
+        return;
     }
     
     cout << "\nAvailable Zones:\n";
@@ -304,41 +957,62 @@ void ParkingSystem::requestParking() {
     
     cout << "\nProcessing parking request...\n";
     
-    // Create request
-    requests[requestCount].init(requestCount, vID, zone);
-    
-    // Try to allocate
-    int allocZone, allocArea, allocSlot;
-    float penalty = 0;
-    
-    if (allocate(zone, vID, allocZone, allocArea, allocSlot, penalty)) {
-        requests[requestCount].setAllocation(allocZone, allocArea, allocSlot, penalty);
-        requests[requestCount].changeState(ALLOCATED);
-        
-        // Save for rollback
-        RollbackEntry entry(requestCount, allocZone, allocArea, allocSlot, REQUESTED);
-        rollbackMgr.push(entry);
-        
-        history->add(requests[requestCount]);
-        zoneUsage[allocZone]++;
-        
+    int rID = submitRequest(vID, zone);
+    if (rID >= 0) {
         cout << "\nParking slot allocated successfully!\n";
-        requests[requestCount].display();
-        requestCount++;
-    } else {
-        waitQueue->enqueue(vID, zone);
+        requests[rID].display();
+    } else if (rID == REQUEST_QUEUED) {
+        int waitZone = zone;
+        int pos = getQueuePosition(vID, waitZone);
         cout << "\nNo parking available in requested or nearby zones.\n";
-        cout << "Vehicle added to waiting queue.\n\n";
+        cout << "Vehicle added to waiting queue - #" << pos << " in line for "
+             << zones[waitZone].getName() << ".\n\n";
         waitQueue->display();
+    } else {
+        cout << "\nError: Request rejected.\n";
     }
     
     pause();
 }
 
+int ParkingSystem::findVehicleByPlate(const std::string& plate) {
+    return plateIndex.find(plate);
+}
+
+int ParkingSystem::findActiveRequest(int vID) {
+    return activeByVehicle.get(vID);
+}
+
+// Keeps the vehicle -> active request index and the hold timer in step
+// with rID's state
+void ParkingSystem::syncActiveIndex(int rID) {
+    int vID = requests[rID].getVehicleID();
+    RequestState state = requests[rID].getState();
+    if (state == ALLOCATED || state == OCCUPIED) {
+        activeByVehicle.put(vID, rID);
+    } else if (activeByVehicle.get(vID) == rID) {
+        activeByVehicle.erase(vID);
+    }
+    syncHoldTimer(rID);
+}
+
+// A timer runs exactly while the request is ALLOCATED, from its
+// allocation time
+void ParkingSystem::syncHoldTimer(int rID) {
+    if (holdTimeout > 0 && requests[rID].getState() == ALLOCATED) {
+        if (!holdTimers.isArmed(rID)) {
+            int64_t allocated = requests[rID].getAllocationTime().getNanos() / HOLD_TICK_NS;
+            holdTimers.arm(rID, allocated + holdTimeout * 1000LL);
+        }
+    } else {
+        holdTimers.cancel(rID);
+    }
+}
+
 bool ParkingSystem::allocate(int reqZone, int vID, int& allocZone, int& allocArea, 
                             int& allocSlot, float& penalty) {
     return allocEngine.allocate(reqZone, vID, allocZone, allocArea, allocSlot, 
-                                penalty, zones, zoneCount);
+                                penalty, zones, zoneCount, vehicleNeeds[vID]);
 }
 
 void ParkingSystem::changeState() {
@@ -380,22 +1054,16 @@ void ParkingSystem::changeState() {
     else if (choice == 2) newState = RELEASED;
     else newState = CANCELLED;
     
-    if (requests[rID].changeState(newState)) {
+    if (transitionRequest(rID, newState)) {
         if (newState == RELEASED || newState == CANCELLED) {
-            zones[requests[rID].getAllocatedZone()].releaseSlot(
-                requests[rID].getAllocatedArea(),
-                requests[rID].getAllocatedSlot()
-            );
-            
             if (newState == RELEASED) {
-                completed++;
                 cout << "\nParking released successfully!\n";
                 cout << "Duration: " << fixed << setprecision(2) 
                      << requests[rID].getDuration() << " hours\n";
             } else {
-                cancelled++;
                 cout << "\nRequest cancelled successfully!\n";
             }
+            showServedFromQueue();
         } else {
             cout << "\nState changed to " << requests[rID].getStateString() << " successfully!\n";
         }
@@ -418,7 +1086,16 @@ void ParkingSystem::rollback() {
         return;
     }
     
-    rollbackMgr.display();
+    // Page through the journal, ten operations at a time
+    int pages = (rollbackMgr.getSize() + 9) / 10;
+    int page = 1;
+    while (page != 0) {
+        rollbackMgr.display((page - 1) * 10, 10);
+        if (pages == 1) break;
+        page = getInt("\nPage " + to_string(page) + " of " + to_string(pages) + 
+                      " - show page (1-" + to_string(pages) + ", 0 to continue): ", 
+                      0, pages);
+    }
     
     int k = getInt("\nHow many operations to rollback? (1-" + 
                   to_string(rollbackMgr.getSize()) + "): ", 
@@ -426,20 +1103,27 @@ void ParkingSystem::rollback() {
     
     cout << "\nRolling back " << k << " operation(s)...\n\n";
     
-    for (int i = 0; i < k; i++) {
-        RollbackEntry entry;
-        if (rollbackMgr.pop(entry)) {
-            zones[entry.zone].releaseSlot(entry.area, entry.slot);
-            requests[entry.requestID].setState(entry.prevState);
-            cout << "Rolled back Request #" << entry.requestID << "\n";
-        }
+    vector<int> rolledBack;
+    rollbackOperations(k, &rolledBack);
+    for (size_t i = 0; i < rolledBack.size(); i++) {
+        cout << "Rolled back Request #" << rolledBack[i] << "\n";
     }
     
     cout << "\nRollback completed successfully!\n";
+    showServedFromQueue();
     
     pause();
 }
 
+void ParkingSystem::showServedFromQueue() {
+    for (size_t i = 0; i < servedFromQueue.size(); i++) {
+        ParkingRequest& req = requests[servedFromQueue[i]];
+        cout << "\nWaiting Vehicle #" << req.getVehicleID()
+             << " allocated Request #" << req.getRequestID() << "\n";
+        req.display();
+    }
+}
+
 void ParkingSystem::showAnalytics() {
     clearScreen();
     cout << "SYSTEM ANALYTICS & STATISTICS\n";
@@ -448,11 +1132,11 @@ void ParkingSystem::showAnalytics() {
     // Request Statistics
     cout << "\nREQUEST STATISTICS:\n";
     printLine();
-    int active = requestCount - completed - cancelled;
+    int completed = stats.getCompleted(), cancelled = stats.getCancelled();
     cout << "Total Requests: " << requestCount << "\n";
     cout << "Completed: " << completed << "\n";
     cout << "Cancelled: " << cancelled << "\n";
-    cout << "Currently Active: " << active << "\n";
+    cout << "Currently Active: " << getActiveCount() << "\n";
     
     // Zone Usage
     cout << "\nZONE UTILIZATION:\n";
@@ -468,19 +1152,41 @@ void ParkingSystem::showAnalytics() {
             cout << " [PEAK ZONE]";
         }
         cout << "\n";
+        if (stats.getZoneCompleted(i) + stats.getZoneCancelled(i) > 0) {
+            cout << "  Completed: " << stats.getZoneCompleted(i)
+                 << " | Cancelled: " << stats.getZoneCancelled(i)
+                 << " | Cross-Zone In: " << stats.getZoneCrossZone(i)
+                 << " | Avg Duration: " << fixed << setprecision(2)
+                 << stats.getZoneAvgDuration(i) << " hours\n";
+        }
+    }
+    
+    // Occupancy Forecast
+    int horizon = forecastHorizon > 0 ? forecastHorizon : FORECAST_HORIZON;
+    std::vector<float> expected;
+    forecastOccupancy(horizon, expected);
+    cout << "\nOCCUPANCY FORECAST (next " << horizon << " minutes):\n";
+    printLine();
+    for (int i = 0; i < zoneCount; i++) {
+        cout << zones[i].getName() << ": " << fixed << setprecision(1)
+             << zones[i].getOccupancyRate() << "% now, "
+             << expected[i] * 100 << "% expected"
+             << " | Arrivals/min: " << setprecision(2) << forecaster.getArrivalRate(i)
+             << " | Departures/min: " << forecaster.getDepartureRate(i);
+        if (expected[i] >= FILLING_THRESHOLD) cout << " [FILLING]";
+        cout << "\n";
     }
     
     // Parking Statistics
-    int comp, canc, cross;
-    float avg;
-    history->getStats(comp, canc, cross, avg);
+    int cross = stats.getCrossZone();
     
     cout << "\nPARKING INSIGHTS:\n";
     printLine();
-    cout << "Average Parking Duration: " << fixed << setprecision(2) << avg << " hours\n";
+    cout << "Average Parking Duration: " << fixed << setprecision(2) 
+         << stats.getAvgDuration() << " hours\n";
     cout << "Cross-Zone Allocations: " << cross;
-    if (comp > 0) {
-        cout << " (" << fixed << setprecision(1) << ((float)cross/comp * 100) << "%)";
+    if (completed > 0) {
+        cout << " (" << fixed << setprecision(1) << ((float)cross/completed * 100) << "%)";
     }
     cout << "\n";
     
@@ -490,6 +1196,13 @@ void ParkingSystem::showAnalytics() {
     cout << "Registered Vehicles: " << vehicleCount << "\n";
     cout << "Vehicles in Queue: " << waitQueue->getSize() << "\n";
     cout << "Rollback Stack Size: " << rollbackMgr.getSize() << "\n";
+    cout << "History Records: " << history.getCount() << " (" 
+         << history.getSegmentCount() << " segments, " 
+         << history.getSealedCount() << " sealed)\n";
+    cout << "  Allocations: " << history.countState(ALLOCATED)
+         << " | Releases: " << history.countState(RELEASED)
+         << " | Cancellations: " << history.countState(CANCELLED)
+         << " | Rolled Back: " << history.countState(REQUESTED) << "\n";
     
     // Zone Details
     cout << "\nZONE STATUS:\n";
@@ -581,69 +1294,53 @@ void ParkingSystem::runDemo() {
     cout << "\nThis will demonstrate the parking system features automatically.\n\n";
     
     cout << "Step 1: Registering 5 vehicles...\n";
-    vehicles[vehicleCount++].init(0, "ABC-123", 0);
-    vehicles[vehicleCount++].init(1, "XYZ-789", 1);
-    vehicles[vehicleCount++].init(2, "DEF-456", 0);
-    vehicles[vehicleCount++].init(3, "GHI-012", 2);
-    vehicles[vehicleCount++].init(4, "JKL-345", 3);
-    cout << "Registered 5 vehicles successfully.\n\n";
+    const char* plates[] = {"ABC-123", "XYZ-789", "DEF-456", "GHI-012", "JKL-345"};
+    int zonesWanted[] = {0, 1, 0, 2, 3};
+    std::vector<int> vIDs;
+    for (int i = 0; i < 5; i++) {
+        int vID = addVehicle(plates[i], zonesWanted[i] % zoneCount);
+        if (vID < 0) {
+            cout << "  " << plates[i] << " not registered (already registered?)\n";
+            continue;
+        }
+        vIDs.push_back(vID);
+    }
+    cout << "Registered " << vIDs.size() << " vehicles.\n\n";
     
     cout << "Step 2: Creating parking requests...\n";
-    for (int i = 0; i < 4; i++) {
-        requests[requestCount].init(requestCount, i, i % zoneCount);
-        int z, a, s;
-        float p;
-        if (allocate(i % zoneCount, i, z, a, s, p)) {
-            requests[requestCount].setAllocation(z, a, s, p);
-            requests[requestCount].changeState(ALLOCATED);
-            RollbackEntry entry(requestCount, z, a, s, REQUESTED);
-            rollbackMgr.push(entry);
-            history->add(requests[requestCount]);
-            zoneUsage[z]++;
-            cout << "  Allocated parking for Vehicle #" << i << "\n";
-            requestCount++;
+    std::vector<int> rIDs;
+    for (size_t i = 0; i < vIDs.size() && i < 4; i++) {
+        int rID = submitRequest(vIDs[i], (int)i % zoneCount);
+        if (rID >= 0) {
+            cout << "  Allocated parking for Vehicle #" << vIDs[i] << "\n";
+            rIDs.push_back(rID);
         }
     }
     
     cout << "\nStep 3: Updating request states...\n";
-    if (requestCount > 0) {
-        requests[0].changeState(OCCUPIED);
-        cout << "  Request #0 marked as OCCUPIED\n";
-    }
-    if (requestCount > 1) {
-        requests[1].changeState(OCCUPIED);
-        cout << "  Request #1 marked as OCCUPIED\n";
+    for (size_t i = 0; i < rIDs.size() && i < 2; i++) {
+        if (transitionRequest(rIDs[i], OCCUPIED)) {
+            cout << "  Request #" << rIDs[i] << " marked as OCCUPIED\n";
+        }
     }
     
     cout << "\nStep 4: Cancelling a request...\n";
-    if (requestCount > 2) {
-        requests[2].changeState(CANCELLED);
-        zones[requests[2].getAllocatedZone()].releaseSlot(
-            requests[2].getAllocatedArea(),
-            requests[2].getAllocatedSlot()
-        );
-        cancelled++;
-        cout << "  Request #2 cancelled\n";
+    if (rIDs.size() > 2 && transitionRequest(rIDs[2], CANCELLED)) {
+        cout << "  Request #" << rIDs[2] << " cancelled\n";
     }
     
     cout << "\nStep 5: Releasing parking...\n";
-    if (requestCount > 0) {
-        requests[0].changeState(RELEASED);
-        zones[requests[0].getAllocatedZone()].releaseSlot(
-            requests[0].getAllocatedArea(),
-            requests[0].getAllocatedSlot()
-        );
-        completed++;
-        cout << "  Request #0 released (Duration: " << fixed << setprecision(2) 
-             << requests[0].getDuration() << " hours)\n";
+    if (!rIDs.empty() && transitionRequest(rIDs[0], RELEASED)) {
+        cout << "  Request #" << rIDs[0] << " released (Duration: " << fixed << setprecision(2) 
+             << requests[rIDs[0]].getDuration() << " hours)\n";
     }
     
     cout << "\nDemo Summary:\n";
     printLine();
     cout << "Requests Created: " << requestCount << "\n";
-    cout << "Completed: " << completed << "\n";
-    cout << "Cancelled: " << cancelled << "\n";
-    cout << "Active: " << (requestCount - completed - cancelled) << "\n";
+    cout << "Completed: " << stats.getCompleted() << "\n";
+    cout << "Cancelled: " << stats.getCancelled() << "\n";
+    cout << "Active: " << (requestCount - stats.getCompleted() - stats.getCancelled()) << "\n";
     
     cout << "\nDemo completed successfully!\n";
     
@@ -654,6 +1351,8 @@ void ParkingSystem::mainMenu() {
     int choice;
     
     do {
+        expireHolds();
+        refreshForecast();
         clearScreen();
         cout << "SMART PARKING MANAGEMENT SYSTEM\n";
         printLine();
@@ -662,7 +1361,8 @@ void ParkingSystem::mainMenu() {
         cout << "Vehicles: " << vehicleCount 
              << " | Requests: " << requestCount 
              << " | Queue: " << waitQueue->getSize() 
-             << " | Stack: " << rollbackMgr.getSize() << "\n";
+             << " | Stack: " << rollbackMgr.getSize()
+             << " | Holds: " << holdTimers.getArmedCount() << "\n";
         printLine();
         
         cout << "\nMAIN MENU:\n";
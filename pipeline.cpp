@@ -0,0 +1,186 @@
+#include "RequestPipeline.h"
+#include "TimeStamp.h"
+
+static const int IDLE_SPINS = 64;       // empty polls before the engine yields
+static const int64_t IDLE_SLEEP_NS = 1000000;   // yielding idle time before it sleeps
+static const int COMMIT_ATTEMPTS = 3;   // tries at a log commit before the batch fails
+
+RequestPipeline::RequestPipeline(ParkingSystem& target, WriteAheadLog* wal, int capacity)
+    : system(target), log(wal), ring(capacity), running(false), stopping(false),
+      posting(0), batches(0), events(0), failedCommits(0), sleeping(false) {}
+
+RequestPipeline::~RequestPipeline() {
+    stop();
+}
+
+bool RequestPipeline::start() {
+    if (running) return false;
+    stopping = false;
+    running = true;
+    if (log) system.setGroupCommit(true);       // the engine commits once per batch
+    engine = std::thread(&RequestPipeline::run, this);
+    return true;
+}
+
+void RequestPipeline::stop() {
+    if (!running) return;
+    stopping = true;
+    wakeEngine();
+    engine.join();
+    if (log) system.setGroupCommit(false);
+    running = false;
+}
+
+// A producer announces itself before checking for stop, so the engine
+// cannot finish between that check and the push
+bool RequestPipeline::post(const Event& e) {
+    posting.fetch_add(1);
+    bool posted = running && !stopping && ring.push(e);
+    posting.fetch_sub(1);
+    if (posted && sleeping.load()) wakeEngine();
+    return posted;
+}
+
+void RequestPipeline::wakeEngine() {
+    std::lock_guard<std::mutex> lock(wakeLock);
+    sleeping = false;
+    wake.notify_one();
+}
+
+// Sleeps until woken or the next hold is due. Every step here and in
+// post() is sequentially consistent: either a producer's sleeping check
+// comes after sleeping is set, and it wakes the engine, or its posting
+// decrement comes before the check below, which then sees its event.
+// sleeping is cleared under the lock by whoever wakes the engine, so a
+// wakeup that lands before the wait is not lost.
+void RequestPipeline::park() {
+    std::unique_lock<std::mutex> lock(wakeLock);
+    sleeping = true;
+    if (posting != 0 || !ring.isEmpty() || stopping) {
+        sleeping = false;
+        return;
+    }
+    auto woken = [this] { return !sleeping || stopping; };
+    int64_t due = system.nextHoldCheck();
+    if (due < 0) {
+        wake.wait(lock, woken);
+    } else {
+        int64_t wait = due - TimeStamp().getNanos();
+        if (wait > 0) wake.wait_for(lock, std::chrono::nanoseconds(wait), woken);
+    }
+    sleeping = false;
+}
+
+void RequestPipeline::expireDue() {
+    int64_t due = system.nextHoldCheck();
+    if (due < 0 || TimeStamp().getNanos() < due) return;
+    // Nobody waits on these; frames a failed commit leaves pending go
+    // out with the next batch
+    if (system.expireHolds() > 0) commitLog();
+}
+
+// A failed commit keeps its frames pending, so trying again writes them
+bool RequestPipeline::commitLog() {
+    if (!log) return true;
+    for (int attempt = 0; attempt < COMMIT_ATTEMPTS; attempt++) {
+        if (log->commit()) return true;
+    }
+    failedCommits.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool RequestPipeline::post(PipelineOp op, int a, int b, Callback callback, void* context) {
+    return post(Event{op, a, b, TimeStamp().getNanos(), callback, context, nullptr});
+}
+
+std::future<int> RequestPipeline::postAsync(PipelineOp op, int a, int b) {
+    std::promise<int>* promise = new std::promise<int>();
+    std::future<int> result = promise->get_future();
+    if (!post(Event{op, a, b, TimeStamp().getNanos(), nullptr, nullptr, promise})) {
+        promise->set_value(PIPELINE_FULL);
+        delete promise;
+    }
+    return result;
+}
+
+std::future<int> RequestPipeline::submitAsync(int vID, int zone) {
+    return postAsync(PIPE_SUBMIT, vID, zone);
+}
+
+std::future<int> RequestPipeline::transitionAsync(int rID, RequestState newState) {
+    return postAsync(PIPE_TRANSITION, rID, newState);
+}
+
+std::future<int> RequestPipeline::rollbackAsync(int k) {
+    return postAsync(PIPE_ROLLBACK, k, 0);
+}
+
+int RequestPipeline::apply(const Event& e) {
+    switch (e.op) {
+        case PIPE_SUBMIT: return system.submitRequest(e.a, e.b);
+        case PIPE_TRANSITION: return system.transitionRequest(e.a, (RequestState)e.b) ? 1 : 0;
+        case PIPE_ROLLBACK: return system.rollbackOperations(e.a);
+    }
+    return REQUEST_REJECTED;
+}
+
+// Apply a batch, make it durable with one commit, then complete it. A
+// producer never hears of an event before the log holds it; when the
+// commit fails, every event in the batch completes as PIPELINE_UNLOGGED.
+void RequestPipeline::run() {
+    std::vector<Event> batch(PIPELINE_BATCH);
+    std::vector<int> results(PIPELINE_BATCH);
+    int idle = 0;
+    int64_t idleSince = 0;
+    while (true) {
+        int n = 0;
+        while (n < PIPELINE_BATCH && ring.pop(batch[n])) n++;
+        if (n == 0) {
+            // With stop requested and no producer mid-post, an empty ring
+            // stays empty
+            if (stopping && posting == 0) {
+                while (n < PIPELINE_BATCH && ring.pop(batch[n])) n++;
+                if (n == 0) return;
+            } else {
+                if (++idle > IDLE_SPINS) {
+                    expireDue();
+                    int64_t now = TimeStamp().getNanos();
+                    if (idle == IDLE_SPINS + 1) idleSince = now;
+                    if (now - idleSince < IDLE_SLEEP_NS) {
+                        std::this_thread::yield();
+                    } else {
+                        park();
+                        idle = 0;
+                    }
+                }
+                continue;
+            }
+        }
+        idle = 0;
+        
+        for (int i = 0; i < n; i++) results[i] = apply(batch[i]);
+        int64_t due = system.nextHoldCheck();
+        if (due >= 0 && TimeStamp().getNanos() >= due) system.expireHolds();
+        if (!commitLog()) {
+            for (int i = 0; i < n; i++) results[i] = PIPELINE_UNLOGGED;
+        }
+        
+        int64_t done = TimeStamp().getNanos();
+        for (int i = 0; i < n; i++) {
+            Event& e = batch[i];
+            latency.record(done - e.postedNanos);
+            if (e.callback) e.callback(e.context, results[i]);
+            if (e.promise) {
+                e.promise->set_value(results[i]);
+                delete e.promise;
+            }
+        }
+        batches.fetch_add(1, std::memory_order_relaxed);
+        events.fetch_add(n, std::memory_order_relaxed);
+    }
+}
+
+LatencyHistogram& RequestPipeline::getLatency() { return latency; }
+long RequestPipeline::getBatchCount() { return batches.load(std::memory_order_relaxed); }
+long RequestPipeline::getEventCount() { return events.load(std::memory_order_relaxed); }
+long RequestPipeline::getFailedCommitCount() { return failedCommits.load(std::memory_order_relaxed); }
@@ -0,0 +1,219 @@
+#include "ReplayEngine.h"
+#include <cstdlib>
+#include <cstring>
+
+static const size_t IO_BLOCK = 1 << 20;
+
+ReplayEngine::ReplayEngine(ParkingSystem& sys) : system(sys), outFile(nullptr),
+                                                 eventCount(0), errorCount(0) {}
+
+long ReplayEngine::getEventCount() { return eventCount; }
+long ReplayEngine::getErrorCount() { return errorCount; }
+
+bool ReplayEngine::run(const char* inputPath, const char* outputPath) {
+    bool stdIn = strcmp(inputPath, "-") == 0;
+    bool stdOut = strcmp(outputPath, "-") == 0;
+    
+    FILE* in = stdIn ? stdin : fopen(inputPath, "rb");
+    if (!in) return false;
+    FILE* outStream = stdOut ? stdout : fopen(outputPath, "wb");
+    if (!outStream) {
+        if (!stdIn) fclose(in);
+        return false;
+    }
+    
+    run(in, outStream);
+    
+    if (!stdIn) fclose(in);
+    if (!stdOut) fclose(outStream);
+    return true;
+}
+
+// Reads in large blocks and splits lines in place; a partial line at the
+// end of a block is carried over to the front of the next one
+void ReplayEngine::run(FILE* in, FILE* outStream) {
+    outFile = outStream;
+    out.clear();
+    out.reserve(IO_BLOCK + 256);
+    put("line,event,result,id,zone,area,slot,penalty\n");
+    
+    std::vector<char> buffer(IO_BLOCK + 1);
+    size_t carried = 0;
+    long lineNo = 0;
+    
+    while (true) {
+        if (carried == buffer.size() - 1) buffer.resize(buffer.size() * 2);
+        size_t got = fread(&buffer[carried], 1, buffer.size() - 1 - carried, in);
+        size_t filled = carried + got;
+        bool atEnd = got == 0;
+        if (atEnd && filled == 0) break;
+        
+        char* start = &buffer[0];
+        char* end = start + filled;
+        while (true) {
+            char* nl = (char*)memchr(start, '\n', end - start);
+            if (!nl) {
+                if (!atEnd) break;
+                if (start == end) break;
+                nl = end;           // last line without a newline
+            }
+            *nl = '\0';
+            applyLine(start, ++lineNo);
+            start = nl + 1;
+            if (start > end) {
+                start = end;
+                break;
+            }
+        }
+        
+        carried = end - start;
+        memmove(&buffer[0], start, carried);
+        if (atEnd) break;
+    }
+    flush();
+}
+
+void ReplayEngine::flush() {
+    if (!out.empty()) fwrite(&out[0], 1, out.size(), outFile);
+    out.clear();
+    fflush(outFile);
+}
+
+void ReplayEngine::put(const char* text) {
+    out.insert(out.end(), text, text + strlen(text));
+}
+
+void ReplayEngine::putInt(long value) {
+    char digits[24];
+    int n = 0;
+    unsigned long v = value < 0 ? -(unsigned long)value : value;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    if (value < 0) out.push_back('-');
+    while (n) out.push_back(digits[--n]);
+}
+
+void ReplayEngine::putPenalty(float penalty) {
+    long cents = (long)(penalty * 100 + 0.5f);
+    putInt(cents / 100);
+    out.push_back('.');
+    out.push_back((char)('0' + (cents / 10) % 10));
+    out.push_back((char)('0' + cents % 10));
+}
+
+// Record with only the id column filled (-1 leaves it empty)
+void ReplayEngine::record(long lineNo, const char* event, const char* result, long id) {
+    putInt(lineNo);
+    out.push_back(',');
+    put(event);
+    out.push_back(',');
+    put(result);
+    out.push_back(',');
+    if (id >= 0) putInt(id);
+    put(",,,,\n");
+}
+
+// Record for a request that now holds a slot
+void ReplayEngine::recordAllocation(long lineNo, const char* event, int rID) {
+    ParkingRequest* req = system.getRequest(rID);
+    putInt(lineNo);
+    out.push_back(',');
+    put(event);
+    put(",ok,");
+    putInt(rID);
+    out.push_back(',');
+    putInt(req->getAllocatedZone());
+    out.push_back(',');
+    putInt(req->getAllocatedArea());
+    out.push_back(',');
+    putInt(req->getAllocatedSlot());
+    out.push_back(',');
+    putPenalty(req->getPenalty());
+    out.push_back('\n');
+}
+
+void ReplayEngine::recordServed(long lineNo) {
+    const std::vector<int>& served = system.getServedFromQueue();
+    for (size_t i = 0; i < served.size(); i++) {
+        recordAllocation(lineNo, "serve", served[i]);
+    }
+}
+
+static char* nextToken(char*& cursor) {
+    while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r') cursor++;
+    if (!*cursor) return nullptr;
+    char* token = cursor;
+    while (*cursor && *cursor != ' ' && *cursor != '\t' && *cursor != '\r') cursor++;
+    if (*cursor) *cursor++ = '\0';
+    return token;
+}
+
+static bool parseInt(const char* token, int& value) {
+    if (!token) return false;
+    char* end;
+    long v = strtol(token, &end, 10);
+    if (end == token || *end) return false;
+    value = (int)v;
+    return true;
+}
+
+void ReplayEngine::applyLine(char* line, long lineNo) {
+    char* cursor = line;
+    char* event = nextToken(cursor);
+    if (!event || event[0] == '#') return;
+    
+    if (out.size() >= IO_BLOCK) flush();
+    eventCount++;
+    char* arg1 = nextToken(cursor);
+    char* arg2 = nextToken(cursor);
+    int a, b;
+    
+    if (strcmp(event, "zone") == 0) {
+        std::vector<int> capacities;
+        for (char* cap = arg2; cap && *cap; ) {
+            char* end;
+            long v = strtol(cap, &end, 10);
+            if (end == cap || v < 0) { capacities.clear(); break; }
+            capacities.push_back((int)v);
+            cap = (*end == ',') ? end + 1 : end;
+        }
+        if (!arg1 || capacities.empty()) {
+            errorCount++;
+            record(lineNo, event, "error");
+            return;
+        }
+        int zone = system.addZone(arg1, (int)capacities.size(), &capacities[0]);
+        record(lineNo, event, zone >= 0 ? "ok" : "rejected", zone);
+        return;
+    }
+    
+    if (system.getZoneCount() == 0) system.setupCity();
+    
+    if (strcmp(event, "adjacent") == 0 && parseInt(arg1, a) && parseInt(arg2, b)) {
+        record(lineNo, event, system.addAdjacency(a, b) ? "ok" : "rejected");
+    } else if (strcmp(event, "register") == 0 && arg1 && parseInt(arg2, b)) {
+        int vID = system.addVehicle(arg1, b);
+        record(lineNo, event, vID >= 0 ? "ok" : "rejected", vID);
+    } else if (strcmp(event, "request") == 0 && parseInt(arg1, a) && parseInt(arg2, b)) {
+        int rID = system.submitRequest(a, b);
+        if (rID < 0) {
+            record(lineNo, event, rID == REQUEST_QUEUED ? "queued" : "rejected");
+            return;
+        }
+        recordAllocation(lineNo, event, rID);
+    } else if ((strcmp(event, "occupy") == 0 || strcmp(event, "release") == 0 ||
+                strcmp(event, "cancel") == 0) && parseInt(arg1, a)) {
+        RequestState newState = event[0] == 'o' ? OCCUPIED :
+                                event[0] == 'r' ? RELEASED : CANCELLED;
+        record(lineNo, event, system.transitionRequest(a, newState) ? "ok" : "invalid", a);
+        recordServed(lineNo);
+    } else if (strcmp(event, "rollback") == 0 && parseInt(arg1, a)) {
+        record(lineNo, event, "ok", system.rollbackOperations(a));
+        recordServed(lineNo);
+    } else {
+        errorCount++;
+        record(lineNo, event, "error");
+    }
+}
@@ -7,27 +7,116 @@ RollbackEntry::RollbackEntry() : requestID(-1), zone(-1), area(-1),
 RollbackEntry::RollbackEntry(int r, int z, int a, int s, RequestState st) :
     requestID(r), zone(z), area(a), slot(s), prevState(st) {}
 
-RollbackManager::RollbackManager() : top(-1) {}
+static const int ZONE_BITS = 20, AREA_BITS = 16, SLOT_BITS = 24, STATE_BITS = 4;
+
+RollbackManager::RollbackManager() : spare(nullptr), head(0), count(0), retention(0) {}
+
+RollbackManager::~RollbackManager() {
+    for (size_t i = 0; i < segments.size(); i++) delete segments[i];
+    delete spare;
+}
+
+RollbackManager::PackedEntry& RollbackManager::at(int i) {
+    int g = head + i;
+    return segments[g >> ROLLBACK_SEGMENT_BITS]->entries[g & (ROLLBACK_SEGMENT - 1)];
+}
+
+RollbackManager::Segment* RollbackManager::segmentOf(int i) {
+    return segments[(head + i) >> ROLLBACK_SEGMENT_BITS];
+}
+
+void RollbackManager::recycle(Segment* seg) {
+    delete spare;
+    spare = seg;
+}
+
+// Moves the bottom of the journal up; only whole segments are touched
+void RollbackManager::dropOldest(int n) {
+    head += n;
+    count -= n;
+    while (head >= ROLLBACK_SEGMENT) {
+        recycle(segments.front());
+        segments.pop_front();
+        head -= ROLLBACK_SEGMENT;
+    }
+}
+
+bool RollbackManager::canHold(const RollbackEntry& entry) {
+    return entry.zone >= 0 && entry.zone < (1 << ZONE_BITS) &&
+           entry.area >= 0 && entry.area < (1 << AREA_BITS) &&
+           entry.slot >= 0 && entry.slot < (1 << SLOT_BITS);
+}
+
+bool RollbackManager::canAddress(int zone, int areas, int slotsPerArea) {
+    return zone >= 0 && zone < (1 << ZONE_BITS) && areas >= 0 && areas <= (1 << AREA_BITS) &&
+           slotsPerArea >= 0 && slotsPerArea <= (1 << SLOT_BITS);
+}
 
 bool RollbackManager::push(RollbackEntry& entry) {
-    if (top >= 100 - 1) {
-        std::cout << "Error: Rollback stack is full!\n";
-        return false;
+    if (!canHold(entry)) return false;
+    
+    int64_t now = entry.timestamp.getNanos();
+    int g = head + count;
+    if (g == (int)segments.size() * ROLLBACK_SEGMENT) {
+        Segment* seg = spare ? spare : new Segment;
+        spare = nullptr;
+        seg->baseTime = now;
+        segments.push_back(seg);
     }
-    stack[++top] = entry;
+    
+    Segment* seg = segments[g >> ROLLBACK_SEGMENT_BITS];
+    int64_t delta = now > seg->baseTime ? (now - seg->baseTime) / 1000000 : 0;
+    PackedEntry& p = seg->entries[g & (ROLLBACK_SEGMENT - 1)];
+    p.requestID = entry.requestID;
+    p.timeDelta = delta > (int64_t)UINT32_MAX ? UINT32_MAX : (uint32_t)delta;
+    p.location = (uint64_t)entry.zone << (AREA_BITS + SLOT_BITS + STATE_BITS) |
+                 (uint64_t)entry.area << (SLOT_BITS + STATE_BITS) |
+                 (uint64_t)entry.slot << STATE_BITS |
+                 (uint64_t)entry.prevState;
+    count++;
+    
+    if (retention > 0 && count > retention) dropOldest(count - retention);
     return true;
 }
 
 bool RollbackManager::pop(RollbackEntry& entry) {
-    if (top < 0) return false;
-    entry = stack[top--];
+    if (count == 0) return false;
+    entry = getEntry(count - 1);
+    count--;
+    
+    // Give back the top segment once nothing lives in it
+    while (!segments.empty() &&
+           (int)(segments.size() - 1) * ROLLBACK_SEGMENT >= head + count) {
+        recycle(segments.back());
+        segments.pop_back();
+    }
+    if (segments.empty()) head = 0;
     return true;
 }
 
-int RollbackManager::getSize() { return top + 1; }
-bool RollbackManager::isEmpty() { return top < 0; }
+RollbackEntry RollbackManager::getEntry(int i) {
+    PackedEntry& p = at(i);
+    RollbackEntry entry;
+    entry.requestID = p.requestID;
+    entry.zone = (int)(p.location >> (AREA_BITS + SLOT_BITS + STATE_BITS));
+    entry.area = (int)(p.location >> (SLOT_BITS + STATE_BITS)) & ((1 << AREA_BITS) - 1);
+    entry.slot = (int)(p.location >> STATE_BITS) & ((1 << SLOT_BITS) - 1);
+    entry.prevState = (RequestState)(p.location & ((1 << STATE_BITS) - 1));
+    entry.timestamp = TimeStamp::fromNanos(segmentOf(i)->baseTime + (int64_t)p.timeDelta * 1000000);
+    return entry;
+}
+
+int RollbackManager::getSize() { return count; }
+bool RollbackManager::isEmpty() { return count == 0; }
+
+void RollbackManager::setRetention(int maxEntries) {
+    retention = maxEntries > 0 ? maxEntries : 0;
+    if (retention > 0 && count > retention) dropOldest(count - retention);
+}
+
+int RollbackManager::getRetention() { return retention; }
 
-void RollbackManager::display() {
+void RollbackManager::display(int first, int pageSize) {
     if (isEmpty()) {
         std::cout << "Rollback Stack: Empty\n";
         return;
@@ -35,13 +124,14 @@ void RollbackManager::display() {
     
     std::cout << "Rollback Stack (" << getSize() << " operations):\n";
     std::cout << "================================================================\n";
-    for (int i = top; i >= 0 && i > top - 10; i--) {
-        std::cout << (top - i + 1) << ". Request " << stack[i].requestID 
-                  << " | Zone " << stack[i].zone << ", Area " << stack[i].area 
-                  << ", Slot " << stack[i].slot 
-                  << " | Time: " << stack[i].timestamp.toString() << "\n";
+    for (int k = first; k < count && k < first + pageSize; k++) {
+        RollbackEntry e = getEntry(count - 1 - k);
+        std::cout << (k + 1) << ". Request " << e.requestID 
+                  << " | Zone " << e.zone << ", Area " << e.area 
+                  << ", Slot " << e.slot 
+                  << " | Time: " << e.timestamp.toString() << "\n";
     }
-    if (top >= 10) {
-        std::cout << "... and " << (top - 9) << " more operations\n";
+    if (first + pageSize < count) {
+        std::cout << "... and " << (count - first - pageSize) << " more operations\n";
     }
-}
\ No newline at end of file
+}
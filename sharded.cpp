@@ -0,0 +1,467 @@
+#include "ShardedSystem.h"
+#include "TimeStamp.h"
+
+static const int POLL_BATCH = 64;       // messages taken from one ring per pass
+static const int IDLE_SPINS = 64;       // empty passes before a shard yields
+static const int64_t IDLE_SLEEP_NS = 1000000;   // yielding idle time before it sleeps
+
+ShardedParkingSystem::ShardedParkingSystem() : zoneCount(0), shardCount(0),
+                                               stopping(false), flushed(0) {}
+
+ShardedParkingSystem::~ShardedParkingSystem() {
+    stop();
+    for (size_t i = 0; i < shards.size(); i++) {
+        for (size_t r = 0; r < shards[i]->inbox.size(); r++) delete shards[i]->inbox[r];
+        delete shards[i]->replies;
+        delete shards[i];
+    }
+}
+
+int ShardedParkingSystem::addZone(const std::string& name, int numAreas, int* areaCapacities) {
+    if (shardCount > 0) return -1;
+    zones.ensureSize(zoneCount + 1);
+    zones[zoneCount].init(zoneCount, name, numAreas, areaCapacities);
+    return zoneCount++;
+}
+
+bool ShardedParkingSystem::addAdjacency(int fromZone, int toZone) {
+    if (shardCount > 0 || fromZone < 0 || fromZone >= zoneCount ||
+        toZone < 0 || toZone >= zoneCount) {
+        return false;
+    }
+    zones[fromZone].addAdjacent(toZone);
+    return true;
+}
+
+int ShardedParkingSystem::getShardCount() { return shardCount; }
+int ShardedParkingSystem::getShardOf(int zone) { return owner[zone]; }
+
+bool ShardedParkingSystem::start(int shardCountWanted) {
+    if (shardCount > 0 || zoneCount == 0 || shardCountWanted < 1) return false;
+    shardCount = shardCountWanted < zoneCount ? shardCountWanted : zoneCount;
+    routes.buildRoutes(zones, zoneCount);
+    
+    owner.resize(zoneCount);
+    ownedIndex.resize(zoneCount);
+    for (int s = 0; s < shardCount; s++) shards.push_back(new Shard);
+    for (int z = 0; z < zoneCount; z++) {
+        Shard& s = *shards[(long)z * shardCount / zoneCount];
+        owner[z] = (int)((long)z * shardCount / zoneCount);
+        ownedIndex[z] = (int)s.owned.size();
+        s.owned.push_back(z);
+    }
+    
+    for (int i = 0; i < shardCount; i++) {
+        Shard& s = *shards[i];
+        s.id = i;
+        s.ownedFree.assign(wordsFor((int)s.owned.size()), 0);
+        for (size_t k = 0; k < s.owned.size(); k++) {
+            if (zones[s.owned[k]].hasSlots()) s.ownedFree[k / BITS_PER_WORD] |= 1ULL << (k % BITS_PER_WORD);
+        }
+        for (int from = 0; from <= shardCount; from++) {
+            s.inbox.push_back(new SpscRing<ShardMessage>(SHARD_RING_SIZE));
+        }
+        s.replies = new SpscRing<ShardReply>(SHARD_RING_SIZE);
+        s.backlog.resize(shardCount);
+        s.pushed.assign(shardCount, 0);
+    }
+    dispatched.assign(shardCount, 0);
+    
+    stopping = false;
+    flushed = 0;
+    for (int i = 0; i < shardCount; i++) {
+        shards[i]->thread = std::thread(&ShardedParkingSystem::run, this, std::ref(*shards[i]));
+    }
+    return true;
+}
+
+// Every reply has been collected, so no request is still being placed;
+// what may still be in flight are RELEASE messages. Each shard flushes
+// what it has to send, and once all have, drains its rings a last time.
+void ShardedParkingSystem::stop() {
+    if (shardCount == 0 || stopping) return;
+    stopping = true;
+    for (int i = 0; i < shardCount; i++) wake(shards[i]->sleep);
+    for (int i = 0; i < shardCount; i++) shards[i]->thread.join();
+}
+
+ParkingRequest* ShardedParkingSystem::getRequest(int rID) {
+    if (rID < 0 || shardCount == 0) return nullptr;
+    Shard& s = *shards[rID % shardCount];
+    int local = rID / shardCount;
+    return local < s.requestCount ? &s.requests[local] : nullptr;
+}
+
+Zone* ShardedParkingSystem::getZone(int zone) {
+    return zone >= 0 && zone < zoneCount ? &zones[zone] : nullptr;
+}
+
+// ==================== Shard side ====================
+
+void ShardedParkingSystem::run(Shard& s) {
+    int idle = 0;
+    int64_t idleSince = 0;
+    bool counted = false;
+    while (true) {
+        bool busy = poll(s);
+        bool clear = flush(s);
+        wakePushed(s);
+        if (stopping.load(std::memory_order_acquire)) {
+            if (clear && !counted) {
+                flushed.fetch_add(1);
+                counted = true;
+            }
+            if (counted && flushed.load() == shardCount) {
+                poll(s);
+                return;
+            }
+        }
+        if (busy) {
+            idle = 0;
+        } else if (++idle > IDLE_SPINS) {
+            // A shard still holding messages waits on a busy peer or the
+            // router, so it yields rather than sleeps
+            int64_t now = TimeStamp().getNanos();
+            if (idle == IDLE_SPINS + 1) idleSince = now;
+            if (now - idleSince < IDLE_SLEEP_NS || !clear || stopping) {
+                std::this_thread::yield();
+            } else {
+                park(s.sleep, &s);
+                idle = 0;
+            }
+        }
+    }
+}
+
+bool ShardedParkingSystem::poll(Shard& s) {
+    bool busy = false;
+    ShardMessage m;
+    for (size_t r = 0; r < s.inbox.size(); r++) {
+        for (int n = 0; n < POLL_BATCH && s.inbox[r]->pop(m); n++) {
+            handle(s, m);
+            busy = true;
+        }
+    }
+    return busy;
+}
+
+// Pushes held-back messages; true when nothing is left to send
+bool ShardedParkingSystem::flush(Shard& s) {
+    bool clear = true;
+    for (int t = 0; t < shardCount; t++) {
+        std::deque<ShardMessage>& q = s.backlog[t];
+        while (!q.empty() && shards[t]->inbox[1 + s.id]->push(q.front())) {
+            q.pop_front();
+            s.pushed[t] = 1;
+        }
+        clear = clear && q.empty();
+    }
+    while (!s.replyBacklog.empty() && s.replies->push(s.replyBacklog.front())) {
+        s.replyBacklog.pop_front();
+        s.replied = true;
+    }
+    return clear && s.replyBacklog.empty();
+}
+
+// Never blocks: a full ring gets the message later, in order, from flush()
+void ShardedParkingSystem::send(Shard& s, int to, const ShardMessage& m) {
+    if (!s.backlog[to].empty() || !shards[to]->inbox[1 + s.id]->push(m)) {
+        s.backlog[to].push_back(m);
+    } else {
+        s.pushed[to] = 1;
+    }
+}
+
+void ShardedParkingSystem::reply(Shard& s, const ShardReply& r) {
+    if (!s.replyBacklog.empty() || !s.replies->push(r)) s.replyBacklog.push_back(r);
+    else s.replied = true;
+}
+
+// Once per pass rather than per message, as waking costs an exchange
+void ShardedParkingSystem::wakePushed(Shard& s) {
+    for (int t = 0; t < shardCount; t++) {
+        if (s.pushed[t]) {
+            s.pushed[t] = 0;
+            wake(shards[t]->sleep);
+        }
+    }
+    if (s.replied) {
+        s.replied = false;
+        wake(routerSleep);
+    }
+}
+
+// s is the sleeping shard, or null for the router. Both sides of the
+// sleeping flag are exchanges: either the waker's exchange comes first,
+// and this side then sees everything pushed before it, or it comes
+// after and finds the flag set. A wakeup that lands before the wait
+// clears the flag, so it is not lost.
+void ShardedParkingSystem::park(Sleeper& w, Shard* s) {
+    std::unique_lock<std::mutex> lock(w.lock);
+    w.sleeping.exchange(true);
+    bool empty = true;
+    if (s) {
+        for (size_t r = 0; r < s->inbox.size(); r++) empty = empty && s->inbox[r]->isEmpty();
+    } else {
+        for (int i = 0; i < shardCount; i++) empty = empty && shards[i]->replies->isEmpty();
+    }
+    if (empty && !stopping) {
+        w.wake.wait(lock, [&w, this] { return !w.sleeping || stopping; });
+    }
+    w.sleeping = false;
+}
+
+void ShardedParkingSystem::wake(Sleeper& w) {
+    if (w.sleeping.exchange(false)) {
+        std::lock_guard<std::mutex> lock(w.lock);
+        w.wake.notify_one();
+    }
+}
+
+void ShardedParkingSystem::handle(Shard& s, ShardMessage& m) {
+    switch (m.type) {
+        case SHARD_REQUEST: {
+            int p;
+            if (s.freePending.empty()) {
+                p = (int)s.pending.size();
+                s.pending.push_back(Pending());
+            } else {
+                p = s.freePending.back();
+                s.freePending.pop_back();
+            }
+            s.pending[p] = Pending{m.a, m.b, m.c, routes.getRouteStart(m.b), 0};
+            advance(s, p);
+            break;
+        }
+        case SHARD_TRANSITION: {
+            ShardReply r = {m.c, 0, BatchResult{false, -1, -1, -1, 0}};
+            int local = m.a / shardCount;
+            if (m.a >= 0 && m.a % shardCount == s.id && local < s.requestCount &&
+                isClientTransition(m.b)) {
+                ParkingRequest& req = s.requests[local];
+                RequestState newState = (RequestState)m.b;
+                RequestState old = req.getState();
+                if (req.changeState(newState)) {
+                    r.result = 1;
+                    if ((old == ALLOCATED || old == OCCUPIED) &&
+                        (newState == RELEASED || newState == CANCELLED)) {
+                        int z = req.getAllocatedZone();
+                        if (owner[z] == s.id) {
+                            releaseLocal(s, z, req.getAllocatedArea(), req.getAllocatedSlot());
+                        } else {
+                            send(s, owner[z], ShardMessage{SHARD_RELEASE, z, req.getAllocatedArea(),
+                                                           req.getAllocatedSlot(), 0, 0});
+                        }
+                    }
+                }
+            }
+            reply(s, r);
+            break;
+        }
+        case SHARD_RESERVE: {
+            int z = m.a, hops = m.d, area, slot;
+            if (z == -1) {
+                z = anyLocal(s, m.d);
+                hops = FAR_HOPS;
+            }
+            if (z != -1 && claimLocal(s, z, m.b, area, slot)) {
+                send(s, m.e, ShardMessage{SHARD_GRANT, z, area, m.c, slot, hops});
+            } else {
+                send(s, m.e, ShardMessage{SHARD_DENY, 0, 0, m.c, 0, 0});
+            }
+            break;
+        }
+        case SHARD_GRANT: finish(s, m.c, m.a, m.b, m.d, m.e); break;
+        case SHARD_DENY: advance(s, m.c); break;
+        case SHARD_RELEASE: releaseLocal(s, m.a, m.b, m.c); break;
+    }
+}
+
+// Carries on placing pending request p: the rest of its route list, then
+// any zone on each shard in turn starting with this one. Stops at the
+// first zone on another shard and waits for its GRANT or DENY.
+void ShardedParkingSystem::advance(Shard& s, int p) {
+    Pending& w = s.pending[p];
+    int end = routes.getRouteStart(w.zone + 1);
+    int area, slot;
+    while (w.next < end) {
+        int k = w.next++;
+        int z = routes.getRouteZone(k);
+        if (!zones[z].hasSlots()) continue;     // atomic read; a hint for remote zones
+        if (owner[z] == s.id) {
+            if (claimLocal(s, z, w.vehicleID, area, slot)) {
+                finish(s, p, z, area, slot, routes.getRouteHops(k));
+                return;
+            }
+            continue;
+        }
+        send(s, owner[z], ShardMessage{SHARD_RESERVE, z, w.vehicleID, p,
+                                       routes.getRouteHops(k), s.id});
+        return;
+    }
+    
+    while (w.shardsAsked < shardCount) {
+        int t = (s.id + w.shardsAsked++) % shardCount;
+        if (t == s.id) {
+            int z = anyLocal(s, w.zone);
+            if (z != -1 && claimLocal(s, z, w.vehicleID, area, slot)) {
+                finish(s, p, z, area, slot, FAR_HOPS);
+                return;
+            }
+            continue;
+        }
+        send(s, t, ShardMessage{SHARD_RESERVE, -1, w.vehicleID, p, w.zone, s.id});
+        return;
+    }
+    
+    reply(s, ShardReply{w.tag, REQUEST_FULL, BatchResult{false, -1, -1, -1, 0}});
+    s.freePending.push_back(p);
+}
+
+void ShardedParkingSystem::finish(Shard& s, int p, int zone, int area, int slot, int hops) {
+    Pending& w = s.pending[p];
+    float penalty = AllocationEngine::penaltyFor(hops);
+    int local = s.requestCount++;
+    int rID = local * shardCount + s.id;
+    s.requests.ensureSize(s.requestCount);
+    ParkingRequest& req = s.requests[local];
+    req.init(rID, w.vehicleID, w.zone);
+    req.setAllocation(zone, area, slot, penalty);
+    req.changeState(ALLOCATED);
+    reply(s, ShardReply{w.tag, rID, BatchResult{true, zone, area, slot, penalty}});
+    s.freePending.push_back(p);
+}
+
+bool ShardedParkingSystem::claimLocal(Shard& s, int zone, int vID, int& area, int& slot) {
+    ParkingSlot* claimed = zones[zone].claimSlot(vID);
+    if (!zones[zone].hasSlots()) {
+        int k = ownedIndex[zone];
+        s.ownedFree[k / BITS_PER_WORD] &= ~(1ULL << (k % BITS_PER_WORD));
+    }
+    if (!claimed) return false;
+    area = claimed->getAreaID();
+    slot = claimed->getSlotID();
+    return true;
+}
+
+void ShardedParkingSystem::releaseLocal(Shard& s, int zone, int area, int slot) {
+    if (!zones[zone].releaseSlot(area, slot)) return;
+    int k = ownedIndex[zone];
+    s.ownedFree[k / BITS_PER_WORD] |= 1ULL << (k % BITS_PER_WORD);
+}
+
+// Lowest owned zone with a free slot other than skipZone, or -1. Only
+// this shard's thread changes its zones, so the bitmap is exact.
+int ShardedParkingSystem::anyLocal(Shard& s, int skipZone) {
+    for (size_t w = 0; w < s.ownedFree.size(); w++) {
+        uint64_t word = s.ownedFree[w];
+        while (word) {
+            int z = s.owned[w * BITS_PER_WORD + lowestSetBit(word)];
+            word &= word - 1;
+            if (z != skipZone) return z;
+        }
+    }
+    return -1;
+}
+
+// ==================== Router side ====================
+
+void ShardedParkingSystem::dispatch(int shard, const ShardMessage& m) {
+    dispatched[shard] = 1;
+    while (!shards[shard]->inbox[0]->push(m)) {
+        wake(shards[shard]->sleep);
+        std::this_thread::yield();
+    }
+}
+
+void ShardedParkingSystem::collect(std::vector<ShardReply>& out, long expected) {
+    for (int i = 0; i < shardCount; i++) {
+        if (dispatched[i]) {
+            dispatched[i] = 0;
+            wake(shards[i]->sleep);
+        }
+    }
+    
+    ShardReply r;
+    int idle = 0;
+    int64_t idleSince = 0;
+    while ((long)out.size() < expected) {
+        bool got = false;
+        for (int i = 0; i < shardCount; i++) {
+            while (shards[i]->replies->pop(r)) {
+                out.push_back(r);
+                got = true;
+            }
+        }
+        if (got) {
+            idle = 0;
+        } else if (++idle > IDLE_SPINS) {
+            int64_t now = TimeStamp().getNanos();
+            if (idle == IDLE_SPINS + 1) idleSince = now;
+            if (now - idleSince < IDLE_SLEEP_NS) {
+                std::this_thread::yield();
+            } else {
+                park(routerSleep, nullptr);
+                idle = 0;
+            }
+        }
+    }
+}
+
+void ShardedParkingSystem::submitAll(const std::vector<BatchRequest>& batch,
+                                     std::vector<int>& rIDs, std::vector<BatchResult>& placed) {
+    int n = (int)batch.size();
+    rIDs.assign(n, REQUEST_REJECTED);
+    placed.assign(n, BatchResult{false, -1, -1, -1, 0});
+    if (shardCount == 0 || stopping) return;
+    
+    // Keep at most one ring's worth in flight per shard, so a shard
+    // never waits on the router to drain its replies
+    std::vector<ShardReply> replies;
+    replies.reserve(n);
+    long sent = 0;
+    for (int i = 0; i < n; i++) {
+        int z = batch[i].zone;
+        if (z < 0 || z >= zoneCount) continue;
+        if (sent - (long)replies.size() >= SHARD_RING_SIZE) collect(replies, sent - SHARD_RING_SIZE / 2);
+        dispatch(owner[z], ShardMessage{SHARD_REQUEST, batch[i].vehicleID, z, i, 0, 0});
+        sent++;
+    }
+    collect(replies, sent);
+    for (size_t r = 0; r < replies.size(); r++) {
+        rIDs[replies[r].tag] = replies[r].result;
+        placed[replies[r].tag] = replies[r].placed;
+    }
+}
+
+void ShardedParkingSystem::transitionAll(const std::vector<int>& rIDs, RequestState newState,
+                                         std::vector<int>& done) {
+    int n = (int)rIDs.size();
+    done.assign(n, 0);
+    if (shardCount == 0 || stopping || !isClientTransition(newState)) return;
+    
+    std::vector<ShardReply> replies;
+    replies.reserve(n);
+    long sent = 0;
+    for (int i = 0; i < n; i++) {
+        if (rIDs[i] < 0) continue;
+        if (sent - (long)replies.size() >= SHARD_RING_SIZE) collect(replies, sent - SHARD_RING_SIZE / 2);
+        dispatch(rIDs[i] % shardCount, ShardMessage{SHARD_TRANSITION, rIDs[i], newState, i, 0, 0});
+        sent++;
+    }
+    collect(replies, sent);
+    for (size_t r = 0; r < replies.size(); r++) done[replies[r].tag] = replies[r].result;
+}
+
+int ShardedParkingSystem::submitRequest(int vID, int zone) {
+    std::vector<int> rIDs;
+    std::vector<BatchResult> placed;
+    submitAll(std::vector<BatchRequest>(1, BatchRequest{vID, zone}), rIDs, placed);
+    return rIDs[0];
+}
+
+bool ShardedParkingSystem::transitionRequest(int rID, RequestState newState) {
+    std::vector<int> done;
+    transitionAll(std::vector<int>(1, rID), newState, done);
+    return done[0] == 1;
+}
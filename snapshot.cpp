@@ -0,0 +1,466 @@
+#include "ParkingSystem.h"
+#include "Snapshot.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Read-only view of a whole file: mmap where available, one read otherwise
+class MappedFile {
+private:
+    const char* data;
+    size_t size;
+#ifdef _WIN32
+    std::vector<char> buffer;
+#endif
+
+public:
+    MappedFile() : data(nullptr), size(0) {}
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef _WIN32
+    bool open(const char* path) {
+        FILE* f = fopen(path, "rb");
+        if (!f) return false;
+        fseek(f, 0, SEEK_END);
+        long n = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if (n > 0) {
+            buffer.resize((size_t)n);
+            if (fread(&buffer[0], 1, buffer.size(), f) != buffer.size()) buffer.clear();
+        }
+        fclose(f);
+        data = buffer.empty() ? nullptr : &buffer[0];
+        size = buffer.size();
+        return data != nullptr;
+    }
+    
+    ~MappedFile() {}
+#else
+    bool open(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data = static_cast<const char*>(p);
+                size = (size_t)st.st_size;
+            }
+        }
+        close(fd);
+        return data != nullptr;
+    }
+    
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), size);
+    }
+#endif
+
+    const char* getData() { return data; }
+    size_t getSize() { return size; }
+};
+
+size_t padded(size_t bytes) {
+    return (bytes + 7) & ~(size_t)7;
+}
+
+template <typename T>
+void addSection(SnapHeader& header, int id, const std::vector<T>& records, uint64_t& offset) {
+    header.sections[id].offset = offset;
+    header.sections[id].count = records.size();
+    offset += padded(records.size() * sizeof(T));
+}
+
+template <typename T>
+bool writeSection(FILE* f, const std::vector<T>& records) {
+    static const char zeros[8] = {0};
+    size_t bytes = records.size() * sizeof(T);
+    size_t pad = padded(bytes) - bytes;
+    return (bytes == 0 || fwrite(records.data(), 1, bytes, f) == bytes) &&
+           (pad == 0 || fwrite(zeros, 1, pad, f) == pad);
+}
+
+// Records of section id, or nullptr if they do not fit inside the file
+template <typename T>
+const T* section(const char* base, size_t size, const SnapHeader& header, int id) {
+    uint64_t offset = header.sections[id].offset;
+    uint64_t count = header.sections[id].count;
+    if (offset % 8 != 0 || offset > size || count > (size - offset) / sizeof(T)) {
+        return nullptr;
+    }
+    return reinterpret_cast<const T*>(base + offset);
+}
+
+bool copyName(char* dest, size_t destSize, const std::string& src) {
+    if (src.size() >= destSize) return false;
+    memset(dest, 0, destSize);
+    memcpy(dest, src.data(), src.size());
+    return true;
+}
+
+// Sections of a mapped snapshot, read in place
+struct SnapImage {
+    const SnapZone* zones;
+    const int32_t* areas;
+    const int32_t* adjacent;
+    const SnapSlot* slots;
+    const SnapVehicle* vehicles;
+    const SnapRequest* requests;
+    const SnapWaiter* waiting;
+    const SnapRollback* rollback;
+    const SnapSlotAttr* attributes;
+    uint64_t count[SNAP_SECTION_COUNT];
+};
+
+bool mapImage(const char* base, size_t size, const SnapHeader& header, SnapImage& img) {
+    img.zones = section<SnapZone>(base, size, header, SNAP_ZONES);
+    img.areas = section<int32_t>(base, size, header, SNAP_AREAS);
+    img.adjacent = section<int32_t>(base, size, header, SNAP_ADJACENT);
+    img.slots = section<SnapSlot>(base, size, header, SNAP_SLOTS);
+    img.vehicles = section<SnapVehicle>(base, size, header, SNAP_VEHICLES);
+    img.requests = section<SnapRequest>(base, size, header, SNAP_REQUESTS);
+    img.waiting = section<SnapWaiter>(base, size, header, SNAP_WAITING);
+    img.rollback = section<SnapRollback>(base, size, header, SNAP_ROLLBACK);
+    img.attributes = section<SnapSlotAttr>(base, size, header, SNAP_ATTRIBUTES);
+    for (int i = 0; i < SNAP_SECTION_COUNT; i++) img.count[i] = header.sections[i].count;
+    return img.zones && img.areas && img.adjacent && img.slots && img.vehicles &&
+           img.requests && img.waiting && img.rollback && img.attributes &&
+           img.count[SNAP_ZONES] <= INT32_MAX && img.count[SNAP_VEHICLES] <= INT32_MAX &&
+           img.count[SNAP_REQUESTS] <= INT32_MAX;
+}
+
+// Everything loading could refuse, checked against the image alone, so a
+// bad file is turned away before the system is touched
+bool checkImage(const SnapImage& img) {
+    int zoneTotal = (int)img.count[SNAP_ZONES];
+    int vehicleTotal = (int)img.count[SNAP_VEHICLES];
+    int requestTotal = (int)img.count[SNAP_REQUESTS];
+    
+    // Area a of zone z is areas[firstArea[z] + a]; its slot s is number
+    // firstSlot[firstArea[z] + a] + s across the city
+    std::vector<uint64_t> firstArea(zoneTotal + 1, 0);
+    uint64_t adjacentTotal = 0;
+    for (int z = 0; z < zoneTotal; z++) {
+        if (img.zones[z].areaCount < 0 || img.zones[z].adjacentCount < 0) return false;
+        firstArea[z + 1] = firstArea[z] + img.zones[z].areaCount;
+        adjacentTotal += img.zones[z].adjacentCount;
+    }
+    uint64_t areaTotal = firstArea[zoneTotal];
+    if (areaTotal != img.count[SNAP_AREAS] || adjacentTotal != img.count[SNAP_ADJACENT]) {
+        return false;
+    }
+    std::vector<uint64_t> firstSlot(areaTotal + 1, 0);
+    for (uint64_t a = 0; a < areaTotal; a++) {
+        if (img.areas[a] < 0) return false;
+        firstSlot[a + 1] = firstSlot[a] + img.areas[a];
+    }
+    for (int z = 0; z < zoneTotal; z++) {
+        int widest = 0;
+        for (uint64_t a = firstArea[z]; a < firstArea[z + 1]; a++) {
+            widest = std::max(widest, (int)img.areas[a]);
+        }
+        if (!RollbackManager::canAddress(z, img.zones[z].areaCount, widest)) return false;
+    }
+    auto slotNumber = [&](int zone, int area, int slot) -> int64_t {
+        if (zone < 0 || zone >= zoneTotal || area < 0 || area >= img.zones[zone].areaCount) return -1;
+        uint64_t a = firstArea[zone] + area;
+        if (slot < 0 || slot >= img.areas[a]) return -1;
+        return (int64_t)(firstSlot[a] + slot);
+    };
+    
+    for (uint64_t i = 0; i < adjacentTotal; i++) {
+        if (img.adjacent[i] < 0 || img.adjacent[i] >= zoneTotal) return false;
+    }
+    for (uint64_t i = 0; i < img.count[SNAP_ATTRIBUTES]; i++) {
+        const SnapSlotAttr& rec = img.attributes[i];
+        if (slotNumber(rec.zone, rec.area, rec.slot) < 0 || rec.attrs < 0 || rec.attrs >= SLOT_CLASSES) {
+            return false;
+        }
+    }
+    std::vector<int> occupant(firstSlot[areaTotal], -1);
+    for (uint64_t i = 0; i < img.count[SNAP_SLOTS]; i++) {
+        const SnapSlot& rec = img.slots[i];
+        int64_t n = slotNumber(rec.zone, rec.area, rec.slot);
+        if (n < 0 || occupant[n] != -1 || rec.vehicleID < 0 || rec.vehicleID >= vehicleTotal) {
+            return false;
+        }
+        occupant[n] = rec.vehicleID;
+    }
+    
+    PlateIndex plates;
+    for (int v = 0; v < vehicleTotal; v++) {
+        const SnapVehicle& rec = img.vehicles[v];
+        std::string plate(rec.plate, strnlen(rec.plate, sizeof(rec.plate)));
+        if (rec.preferredZone < 0 || rec.preferredZone >= zoneTotal ||
+            rec.needs < 0 || rec.needs >= SLOT_CLASSES || !plates.insert(plate, v)) {
+            return false;
+        }
+    }
+    
+    // Each active request holds the occupied slot it names, and each
+    // occupied slot and each vehicle has at most one of them; with as
+    // many active requests as occupied slots, every slot has exactly one
+    std::vector<char> held(occupant.size(), 0), active(vehicleTotal, 0);
+    uint64_t activeTotal = 0;
+    for (int r = 0; r < requestTotal; r++) {
+        const SnapRequest& rec = img.requests[r];
+        if (rec.vehicleID < 0 || rec.vehicleID >= vehicleTotal ||
+            rec.requestedZone < 0 || rec.requestedZone >= zoneTotal ||
+            rec.allocatedZone < -1 || rec.allocatedZone >= zoneTotal ||
+            rec.state < REQUESTED || rec.state > CANCELLED) {
+            return false;
+        }
+        if (rec.state != ALLOCATED && rec.state != OCCUPIED) continue;
+        int64_t n = slotNumber(rec.allocatedZone, rec.allocatedArea, rec.allocatedSlot);
+        if (n < 0 || occupant[n] != rec.vehicleID || held[n] || active[rec.vehicleID]) return false;
+        held[n] = 1;
+        active[rec.vehicleID] = 1;
+        activeTotal++;
+    }
+    if (activeTotal != img.count[SNAP_SLOTS]) return false;
+    std::vector<char> waiting(vehicleTotal, 0);
+    for (uint64_t i = 0; i < img.count[SNAP_WAITING]; i++) {
+        const SnapWaiter& rec = img.waiting[i];
+        if (rec.zone < 0 || rec.zone >= zoneTotal || rec.vehicleID < 0 ||
+            rec.vehicleID >= vehicleTotal || waiting[rec.vehicleID]) {
+            return false;
+        }
+        waiting[rec.vehicleID] = 1;
+    }
+    for (uint64_t i = 0; i < img.count[SNAP_ROLLBACK]; i++) {
+        const SnapRollback& rec = img.rollback[i];
+        if (rec.requestID < 0 || rec.requestID >= requestTotal ||
+            rec.zone < 0 || rec.zone >= zoneTotal ||
+            rec.prevState < REQUESTED || rec.prevState > CANCELLED ||
+            !RollbackManager::canHold(RollbackEntry(rec.requestID, rec.zone, rec.area, rec.slot,
+                                                    (RequestState)rec.prevState))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// Written to path.tmp, flushed to disk and renamed over path, so a crash
+// leaves either the old snapshot or the new one, never a torn file
+bool ParkingSystem::saveSnapshot(const char* path) {
+    std::vector<SnapZone> zoneRecs(zoneCount);
+    std::vector<int32_t> areaRecs, adjacentRecs;
+    std::vector<SnapSlot> slotRecs;
+    std::vector<SnapSlotAttr> attrRecs;
+    for (int z = 0; z < zoneCount; z++) {
+        SnapZone& rec = zoneRecs[z];
+        if (!copyName(rec.name, sizeof(rec.name), zones[z].getName())) return false;
+        rec.areaCount = zones[z].getAreaCount();
+        rec.adjacentCount = zones[z].getAdjacentCount();
+        rec.usage = zoneUsage[z];
+        rec.reserved = 0;
+        
+        for (int a = 0; a < rec.areaCount; a++) {
+            ParkingArea& area = zones[z].getArea(a);
+            areaRecs.push_back(area.getTotal());
+            if (area.getAttributesPresent() != 0) {
+                for (int s = 0; s < area.getTotal(); s++) {
+                    int attrs = area.getSlotAttributes(s);
+                    if (attrs != 0) attrRecs.push_back(SnapSlotAttr{z, a, s, attrs});
+                }
+            }
+            if (area.getAvailable() == area.getTotal()) continue;
+            for (int s = 0; s < area.getTotal(); s++) {
+                int vID = area.getOccupant(s);
+                if (vID != -1) slotRecs.push_back(SnapSlot{z, a, s, vID});
+            }
+        }
+        for (int i = 0; i < rec.adjacentCount; i++) {
+            adjacentRecs.push_back(zones[z].getAdjacent(i));
+        }
+    }
+    
+    std::vector<SnapVehicle> vehicleRecs(vehicleCount);
+    for (int v = 0; v < vehicleCount; v++) {
+        SnapVehicle& rec = vehicleRecs[v];
+        if (!copyName(rec.plate, sizeof(rec.plate), vehicles[v].getPlate())) return false;
+        rec.preferredZone = vehicles[v].getPreferredZone();
+        rec.needs = vehicleNeeds[v];
+    }
+    
+    std::vector<SnapRequest> requestRecs(requestCount);
+    for (int r = 0; r < requestCount; r++) {
+        ParkingRequest& req = requests[r];
+        SnapRequest& rec = requestRecs[r];
+        rec.requestTime = req.getRequestTime().getNanos();
+        rec.allocationTime = req.getAllocationTime().getNanos();
+        rec.releaseTime = req.getReleaseTime().getNanos();
+        rec.vehicleID = req.getVehicleID();
+        rec.requestedZone = req.getRequestedZone();
+        rec.allocatedZone = req.getAllocatedZone();
+        rec.allocatedArea = req.getAllocatedArea();
+        rec.allocatedSlot = req.getAllocatedSlot();
+        rec.state = (int32_t)req.getState();
+        rec.penalty = req.getPenalty();
+        rec.reserved = 0;
+    }
+    
+    std::vector<int> waitVehicles, waitZones;
+    listWaiting(waitVehicles, waitZones);
+    std::vector<SnapWaiter> waitRecs(waitVehicles.size());
+    for (size_t i = 0; i < waitRecs.size(); i++) {
+        waitRecs[i].vehicleID = waitVehicles[i];
+        waitRecs[i].zone = waitZones[i];
+    }
+    
+    std::vector<SnapRollback> rollbackRecs(rollbackMgr.getSize());
+    for (int i = 0; i < rollbackMgr.getSize(); i++) {
+        RollbackEntry entry = rollbackMgr.getEntry(i);
+        SnapRollback& rec = rollbackRecs[i];
+        rec.time = entry.timestamp.getNanos();
+        rec.requestID = entry.requestID;
+        rec.zone = entry.zone;
+        rec.area = entry.area;
+        rec.slot = entry.slot;
+        rec.prevState = (int32_t)entry.prevState;
+        rec.reserved = 0;
+    }
+    
+    SnapHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.headerSize = sizeof(SnapHeader);
+    header.logSequence = logSequence;
+    uint64_t offset = sizeof(SnapHeader);
+    addSection(header, SNAP_ZONES, zoneRecs, offset);
+    addSection(header, SNAP_AREAS, areaRecs, offset);
+    addSection(header, SNAP_ADJACENT, adjacentRecs, offset);
+    addSection(header, SNAP_SLOTS, slotRecs, offset);
+    addSection(header, SNAP_VEHICLES, vehicleRecs, offset);
+    addSection(header, SNAP_REQUESTS, requestRecs, offset);
+    addSection(header, SNAP_WAITING, waitRecs, offset);
+    addSection(header, SNAP_ROLLBACK, rollbackRecs, offset);
+    addSection(header, SNAP_ATTRIBUTES, attrRecs, offset);
+    
+    std::string tmpPath = std::string(path) + ".tmp";
+    FILE* f = fopen(tmpPath.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              writeSection(f, zoneRecs) && writeSection(f, areaRecs) &&
+              writeSection(f, adjacentRecs) && writeSection(f, slotRecs) &&
+              writeSection(f, vehicleRecs) && writeSection(f, requestRecs) &&
+              writeSection(f, waitRecs) && writeSection(f, rollbackRecs) &&
+              writeSection(f, attrRecs) && fflush(f) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(f)) == 0;
+#else
+    ok = ok && fsync(fileno(f)) == 0;
+#endif
+    ok = fclose(f) == 0 && ok;
+
+#ifdef _WIN32
+    // rename() will not replace an existing file here
+    if (ok) remove(path);
+#endif
+    if (!ok || rename(tmpPath.c_str(), path) != 0) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ParkingSystem::loadSnapshot(const char* path) {
+    if (zoneCount != 0 || vehicleCount != 0 || requestCount != 0) return false;
+    
+    MappedFile file;
+    if (!file.open(path) || file.getSize() < sizeof(SnapHeader)) return false;
+    const char* base = file.getData();
+    size_t size = file.getSize();
+    
+    SnapHeader header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SNAPSHOT_VERSION || header.headerSize != sizeof(SnapHeader)) {
+        return false;
+    }
+    SnapImage img;
+    if (!mapImage(base, size, header, img) || !checkImage(img)) return false;
+    
+    // Nothing below can fail once the image checks out, and none of it
+    // is logged: the log picks up after the snapshot
+    WriteAheadLog* attached = wal;
+    wal = nullptr;
+    logSequence = header.logSequence;
+    
+    // Zones, then adjacency once every zone ID exists
+    int zoneTotal = (int)img.count[SNAP_ZONES];
+    std::vector<int> caps;
+    for (int z = 0, a = 0; z < zoneTotal; z++) {
+        const SnapZone& rec = img.zones[z];
+        caps.assign(img.areas + a, img.areas + a + rec.areaCount);
+        a += rec.areaCount;
+        addZone(std::string(rec.name, strnlen(rec.name, sizeof(rec.name))),
+                rec.areaCount, caps.data());
+        zoneUsage[z] = rec.usage;
+    }
+    for (int z = 0, i = 0; z < zoneTotal; z++) {
+        for (int k = 0; k < img.zones[z].adjacentCount; k++) addAdjacency(z, img.adjacent[i++]);
+    }
+    
+    // Attributes before occupants, so the per-class free counts start right
+    for (uint64_t i = 0; i < img.count[SNAP_ATTRIBUTES]; i++) {
+        const SnapSlotAttr& rec = img.attributes[i];
+        setSlotAttributes(rec.zone, rec.area, rec.slot, rec.attrs);
+    }
+    for (uint64_t i = 0; i < img.count[SNAP_SLOTS]; i++) {
+        const SnapSlot& rec = img.slots[i];
+        zones[rec.zone].occupySlot(rec.area, rec.slot, rec.vehicleID);
+    }
+    
+    for (uint64_t v = 0; v < img.count[SNAP_VEHICLES]; v++) {
+        const SnapVehicle& rec = img.vehicles[v];
+        addVehicle(std::string(rec.plate, strnlen(rec.plate, sizeof(rec.plate))),
+                   rec.preferredZone, rec.needs);
+    }
+    
+    int requestTotal = (int)img.count[SNAP_REQUESTS];
+    requests.ensureSize(requestTotal);
+    for (int r = 0; r < requestTotal; r++) {
+        const SnapRequest& rec = img.requests[r];
+        ParkingRequest& req = requests[r];
+        req.init(r, rec.vehicleID, rec.requestedZone, &stats);
+        req.setAllocation(rec.allocatedZone, rec.allocatedArea, rec.allocatedSlot, rec.penalty);
+        req.restore((RequestState)rec.state, TimeStamp::fromNanos(rec.requestTime),
+                    TimeStamp::fromNanos(rec.allocationTime), TimeStamp::fromNanos(rec.releaseTime));
+        requestCount = r + 1;
+        syncActiveIndex(r);
+    }
+    
+    for (uint64_t i = 0; i < img.count[SNAP_WAITING]; i++) {
+        addWaiting(img.waiting[i].vehicleID, img.waiting[i].zone);
+    }
+    
+    for (uint64_t i = 0; i < img.count[SNAP_ROLLBACK]; i++) {
+        const SnapRollback& rec = img.rollback[i];
+        RollbackEntry entry(rec.requestID, rec.zone, rec.area, rec.slot,
+                            (RequestState)rec.prevState);
+        entry.timestamp = TimeStamp::fromNanos(rec.time);
+        rollbackMgr.push(entry);
+    }
+    wal = attached;
+    return true;
+}
@@ -1,46 +1,1375 @@
 #include "TestRunner.h"
+#include "ReplayEngine.h"
+#include "RequestPipeline.h"
+#include "ShardedSystem.h"
+#include "Snapshot.h"
+#include "TimerWheel.h"
+#include <chrono>
+#include <cstddef>
+#include <ctime>
 #include <iostream>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <cstdio>
+#include <string>
 
 bool TestRunner::testSlotAllocation() {
     // Test basic slot allocation
-    return true;
+    Zone zone;
+    int capacities[] = {3, 2};
+    zone.init(0, "Test", 2, capacities);
+    
+    // Fill the zone; slots must come out area by area, lowest slot first
+    for (int i = 0; i < 5; i++) {
+        ParkingSlot* slot = zone.findSlot();
+        if (!slot) return false;
+        if (slot->getAreaID() != (i < 3 ? 0 : 1)) return false;
+        if (slot->getSlotID() != (i < 3 ? i : i - 3)) return false;
+        zone.occupySlot(slot, i);
+    }
+    if (zone.hasSlots() || zone.findSlot() != nullptr) return false;
+    
+    // A released slot is the next one handed out
+    if (!zone.releaseSlot(0, 1)) return false;
+    if (zone.releaseSlot(0, 1)) return false;
+    ParkingSlot* slot = zone.findSlot();
+    if (!slot || slot->getAreaID() != 0 || slot->getSlotID() != 1) return false;
+    if (zone.getAvailable() != 1) return false;
+    
+    // Areas and zones are no longer capped; bitmaps span several words
+    ChunkedArray<Zone> zones;
+    zones.ensureSize(3000);
+    Zone* first = &zones[0];
+    int big[] = {130};
+    zones[2999].init(2999, "Big", 1, big);
+    for (int i = 0; i < 129; i++) {
+        zones[2999].occupySlot(zones[2999].findSlot(), i);
+    }
+    slot = zones[2999].findSlot();
+    return first == &zones[0] && slot && slot->getSlotID() == 129;
 }
 
 bool TestRunner::testCrossZoneAllocation() {
-    // Test cross-zone allocation
-    return true;
+    // A has one slot and lists B as adjacent; the second car for A goes
+    // to B with the adjacency penalty
+    ParkingSystem system;
+    int one[] = {1};
+    system.addZone("A", 1, one);
+    system.addZone("B", 1, one);
+    system.addAdjacency(0, 1);
+    for (int v = 0; v < 3; v++) system.addVehicle("CZ" + std::to_string(v), 0);
+    int home = system.submitRequest(0, 0);
+    int away = system.submitRequest(1, 0);
+    if (home < 0 || away < 0 || system.getRequest(home)->isCrossZone()) return false;
+    ParkingRequest* req = system.getRequest(away);
+    if (req->getAllocatedZone() != 1 || !req->isCrossZone() || req->getPenalty() != 15.0f) {
+        return false;
+    }
+    
+    // With both zones full the third car waits
+    return system.submitRequest(2, 0) == REQUEST_QUEUED && system.getZoneUsage(1) == 1;
 }
 
 bool TestRunner::testInvalidTransition() {
-    // Test invalid state transitions
-    return true;
+    ParkingSystem system;
+    int caps[] = {2};
+    system.addZone("A", 1, caps);
+    system.addVehicle("IT0", 0);
+    int rID = system.submitRequest(0, 0);
+    if (rID < 0 || system.transitionRequest(rID, RELEASED) || 
+        system.transitionRequest(rID, REQUESTED) || system.transitionRequest(rID, (RequestState)7)) {
+        return false;
+    }
+    
+    // Rolled back to REQUESTED, the request still names the slot it gave
+    // back; only the allocator may hand it one again
+    if (system.rollbackOperations(1) != 1 || system.getRequest(rID)->getState() != REQUESTED) return false;
+    if (system.transitionRequest(rID, ALLOCATED) || system.getZone(0)->getAvailable() != 2) return false;
+    return system.transitionRequest(rID, CANCELLED) && system.getZone(0)->getAvailable() == 2;
 }
 
-bool TestRunner::testCancellation() {
-    // Test cancellation
-    return true;
+bool TestRunner::testCancelRequested() {
+    // A request rolled back to REQUESTED holds no slot; cancelling it
+    // frees nothing more
+    ParkingSystem system;
+    int caps[] = {2};
+    system.addZone("A", 1, caps);
+    system.addVehicle("CR0", 0);
+    int rID = system.submitRequest(0, 0);
+    if (rID < 0 || system.rollbackOperations(1) != 1) return false;
+    if (system.getRequest(rID)->getState() != REQUESTED || system.getZone(0)->getAvailable() != 2) {
+        return false;
+    }
+    if (!system.transitionRequest(rID, CANCELLED)) return false;
+    return system.getRequest(rID)->getState() == CANCELLED &&
+           system.getZone(0)->getAvailable() == 2 && system.getStats().getCancelled() == 1 &&
+           !system.transitionRequest(rID, OCCUPIED) && !system.transitionRequest(rID, CANCELLED);
+}
+
+bool TestRunner::testCancelAllocated() {
+    // Cancelling an allocation gives the slot back and lets the vehicle
+    // ask again
+    ParkingSystem system;
+    int one[] = {1};
+    system.addZone("A", 1, one);
+    system.addVehicle("CA0", 0);
+    int rID = system.submitRequest(0, 0);
+    if (rID < 0 || system.getZone(0)->getAvailable() != 0 || system.findActiveRequest(0) != rID) {
+        return false;
+    }
+    if (!system.transitionRequest(rID, CANCELLED)) return false;
+    if (system.getZone(0)->getAvailable() != 1 || system.findActiveRequest(0) != -1 ||
+        system.getStats().getCancelled() != 1 || system.getStats().getCompleted() != 0 ||
+        system.transitionRequest(rID, OCCUPIED)) {
+        return false;
+    }
+    int again = system.submitRequest(0, 0);
+    return again >= 0 && again != rID && system.getRequest(again)->getAllocatedSlot() == 0;
 }
 
 bool TestRunner::testRollback() {
-    // Test rollback functionality
-    return true;
+    // One two-slot zone: request 0 is released (serving waiter 2 into its
+    // slot), request 1 is cancelled, request 2 still holds a slot
+    ParkingSystem system;
+    int caps[] = {2};
+    system.addZone("A", 1, caps);
+    for (int v = 0; v < 3; v++) system.addVehicle("RB" + std::to_string(v), 0);
+    system.submitRequest(0, 0);
+    system.submitRequest(1, 0);
+    if (system.submitRequest(2, 0) != REQUEST_QUEUED) return false;
+    system.transitionRequest(0, OCCUPIED);
+    system.transitionRequest(0, RELEASED);
+    system.transitionRequest(1, CANCELLED);
+    if (system.getServedFromQueue().size() != 0 || system.findActiveRequest(2) != 2) return false;
+    
+    // Undo requests 2 and 1: only request 2 still has a slot to give back
+    std::vector<int> undone;
+    if (system.rollbackOperations(2, &undone) != 2 || undone[0] != 2 || undone[1] != 1) return false;
+    RequestStats& stats = system.getStats();
+    if (system.getZoneUsage(0) != 1 || stats.getCancelled() != 0 || stats.getCompleted() != 1 ||
+        system.findActiveRequest(2) != -1 || system.getRequest(1)->getState() != REQUESTED) {
+        return false;
+    }
+    
+    // Asking for more than is left undoes what there is
+    if (system.rollbackOperations(5) != 1) return false;
+    if (system.getZoneUsage(0) != 0 || stats.getCompleted() != 0 ||
+        system.rollbackOperations(1) != 0 || system.submitRequest(0, 0) < 0 ||
+        system.submitRequest(1, 0) < 0) {
+        return false;
+    }
+    
+    // A zone whose slots the journal could not record is refused up front
+    int huge[] = {2, (1 << 24) + 1};
+    return system.addZone("Huge", 2, huge) == -1 && system.getZoneCount() == 1;
 }
 
 bool TestRunner::testFullLifecycle() {
-    // Test complete parking lifecycle
-    return true;
+    // REQUESTED -> ALLOCATED -> OCCUPIED -> RELEASED, then nothing more
+    ParkingSystem system;
+    int one[] = {1};
+    system.addZone("A", 1, one);
+    system.addVehicle("FL0", 0);
+    system.addVehicle("FL1", 0);
+    int rID = system.submitRequest(0, 0);
+    if (rID < 0 || system.getRequest(rID)->getState() != ALLOCATED) return false;
+    if (system.submitRequest(0, 0) != REQUEST_REJECTED || system.submitRequest(1, 0) != REQUEST_QUEUED) {
+        return false;
+    }
+    if (!system.transitionRequest(rID, OCCUPIED) || system.getRequest(rID)->getState() != OCCUPIED ||
+        system.findActiveRequest(0) != rID) {
+        return false;
+    }
+    
+    // Releasing completes the request and hands the slot to the waiter
+    if (!system.transitionRequest(rID, RELEASED)) return false;
+    ParkingRequest* req = system.getRequest(rID);
+    const std::vector<int>& served = system.getServedFromQueue();
+    return req->getState() == RELEASED && req->getDuration() >= 0 &&
+           system.getStats().getCompleted() == 1 && system.findActiveRequest(0) == -1 &&
+           served.size() == 1 && system.getRequest(served[0])->getVehicleID() == 1 &&
+           !system.transitionRequest(rID, OCCUPIED) && !system.transitionRequest(rID, CANCELLED);
 }
 
 bool TestRunner::testAnalytics() {
-    // Test analytics and statistics
-    return true;
+    // Zone 1 lists zone 0 as adjacent, so its second car overflows there
+    ParkingSystem system;
+    int one[] = {1};
+    system.addZone("A", 1, one);
+    system.addZone("B", 1, one);
+    system.addAdjacency(1, 0);
+    for (int v = 0; v < 3; v++) system.addVehicle("S" + std::to_string(v), 1);
+    system.submitRequest(0, 1);
+    system.submitRequest(1, 1);
+    system.transitionRequest(0, OCCUPIED);
+    system.transitionRequest(0, RELEASED);
+    system.transitionRequest(1, OCCUPIED);
+    system.transitionRequest(1, RELEASED);
+    system.submitRequest(2, 0);
+    system.transitionRequest(2, CANCELLED);
+    
+    RequestStats& stats = system.getStats();
+    if (stats.getCompleted() != 2 || stats.getCancelled() != 1 ||
+        stats.getCrossZone() != 1 || stats.getZoneCompleted(0) != 1 ||
+        stats.getZoneCrossZone(0) != 1 || stats.getZoneCancelled(0) != 1 ||
+        stats.getZoneCompleted(1) != 1) {
+        return false;
+    }
+    
+    // Undoing the cancelled request takes it back out of the totals; back
+    // in REQUESTED, it does not count as active either
+    if (system.getActiveCount() != 0) return false;
+    system.rollbackOperations(1);
+    if (stats.getCancelled() != 0 || stats.getZoneCancelled(0) != 0 || stats.getCompleted() != 2 ||
+        system.getActiveCount() != 0 || system.getRequest(2)->getState() != REQUESTED) {
+        return false;
+    }
+    int rID = system.submitRequest(0, 1);
+    system.transitionRequest(rID, OCCUPIED);
+    return system.getActiveCount() == 1;
 }
 
 bool TestRunner::testZoneUtilization() {
-    // Test zone utilization tracking
+    // Usage counts allocations per zone; free counts follow claims and
+    // releases
+    ParkingSystem system;
+    int caps[] = {2, 1};
+    system.addZone("A", 2, caps);
+    system.addZone("B", 1, caps + 1);
+    for (int v = 0; v < 4; v++) system.addVehicle("ZU" + std::to_string(v), 0);
+    int first = system.submitRequest(0, 0);
+    system.submitRequest(1, 0);
+    system.submitRequest(2, 1);
+    Zone* a = system.getZone(0);
+    if (system.getZoneUsage(0) != 2 || system.getZoneUsage(1) != 1 || a->getTotal() != 3 ||
+        a->getAvailable() != 1 || system.getZone(1)->getAvailable() != 0) {
+        return false;
+    }
+    
+    // A release frees the slot but the zone keeps its usage count
+    system.transitionRequest(first, OCCUPIED);
+    system.transitionRequest(first, RELEASED);
+    if (a->getAvailable() != 2 || system.getZoneUsage(0) != 2) return false;
+    system.submitRequest(3, 0);
+    return system.getZoneUsage(0) == 3 && a->getAvailable() == 1;
+}
+
+bool TestRunner::testActiveRequestIndex() {
+    // Churn the vehicle -> request index and compare against std::map
+    IntHashIndex index;
+    std::map<int, int> expected;
+    unsigned seed = 12345;
+    for (int i = 0; i < 20000; i++) {
+        seed = seed * 1103515245 + 12345;
+        int vID = (seed >> 8) % 500;
+        if ((seed >> 4) & 1) {
+            index.put(vID, i);
+            expected[vID] = i;
+        } else {
+            if (index.erase(vID) != (expected.erase(vID) == 1)) return false;
+        }
+    }
+    if (index.size() != (int)expected.size()) return false;
+    for (int vID = 0; vID < 500; vID++) {
+        std::map<int, int>::iterator it = expected.find(vID);
+        if (index.get(vID) != (it == expected.end() ? -1 : it->second)) return false;
+    }
+    return true;
+}
+
+bool TestRunner::testPlateIndex() {
+    // Plates normalise to one key and can only be registered once
+    PlateIndex index;
+    if (!index.insert("ABC-123", 0)) return false;
+    if (index.insert("abc 123", 1)) return false;
+    if (index.find("ABC123") != 0 || index.find("XYZ-789") != -1) return false;
+    if (index.insert("---", 2) || index.insert("ABCDEFGHIJKLMNOPQ", 2)) return false;
+    
+    // Survives growth with every key still resolvable
+    for (int i = 1; i <= 5000; i++) {
+        if (!index.insert("CAR" + std::to_string(i), i)) return false;
+    }
+    for (int i = 1; i <= 5000; i++) {
+        if (index.find("car-" + std::to_string(i)) != i) return false;
+    }
+    return index.size() == 5001;
+}
+
+bool TestRunner::testConcurrentAllocation() {
+    // Hammer AllocationEngine from several threads on a small city
+    const int THREADS = 8, ZONES = 4, AREAS = 3, SLOTS = 70;
+    ChunkedArray<Zone> zones;
+    zones.ensureSize(ZONES);
+    int capacities[AREAS] = {SLOTS, SLOTS, SLOTS};
+    for (int z = 0; z < ZONES; z++) {
+        zones[z].init(z, "Zone", AREAS, capacities);
+        zones[z].addAdjacent((z + 1) % ZONES);
+    }
+    
+    // owners[] counts holders per slot; anything above 1 is a double booking
+    std::vector<std::atomic<int>> owners(ZONES * AREAS * SLOTS);
+    for (size_t i = 0; i < owners.size(); i++) owners[i] = 0;
+    std::atomic<int> doubleBooked(0), claimed(0);
+    AllocationEngine engine;
+    engine.buildRoutes(zones, ZONES);
+    
+    // Phase 1: churn allocate/release; Phase 2: fill the city to the last slot
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; t++) {
+        workers.push_back(std::thread([&, t]() {
+            std::vector<int> held;
+            for (int i = 0; i < 20000; i++) {
+                int z, a, s;
+                float p;
+                if (engine.allocate((t + i) % ZONES, t, z, a, s, p, zones, ZONES)) {
+                    int key = (z * AREAS + a) * SLOTS + s;
+                    if (owners[key].fetch_add(1) != 0) doubleBooked++;
+                    held.push_back(key);
+                }
+                if (!held.empty() && (held.size() > 20 || (i & 1))) {
+                    int key = held.back();
+                    held.pop_back();
+                    owners[key].fetch_sub(1);
+                    engine.release(zones, key / (AREAS * SLOTS), (key / SLOTS) % AREAS, key % SLOTS);
+                }
+            }
+            int z, a, s;
+            float p;
+            while (engine.allocate(t % ZONES, t, z, a, s, p, zones, ZONES)) {
+                if (owners[(z * AREAS + a) * SLOTS + s].fetch_add(1) != 0) doubleBooked++;
+                claimed++;
+            }
+            claimed += (int)held.size();
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+    
+    if (doubleBooked != 0 || claimed != ZONES * AREAS * SLOTS) return false;
+    for (int z = 0; z < ZONES; z++) {
+        if (zones[z].getAvailable() != 0 || zones[z].findSlot() != nullptr) return false;
+    }
     return true;
 }
 
+bool TestRunner::testReplay() {
+    // Drive a tiny city headless and check the CSV records
+    const char* events =
+        "# two one-slot zones\n"
+        "zone North 1\n"
+        "zone South 1\n"
+        "adjacent 0 1\n"
+        "register ABC-123 0\n"
+        "register abc123 0\n"
+        "register XYZ-789 0\n"
+        "register QRS-456 0\n"
+        "request 0 0\n"
+        "request 1 0\n"
+        "request 2 0\n"
+        "occupy 0\n"
+        "cancel 0\n"
+        "release 0\n"
+        "bogus 1 2\n"
+        "rollback 1";
+    const char* expected =
+        "line,event,result,id,zone,area,slot,penalty\n"
+        "2,zone,ok,0,,,,\n"
+        "3,zone,ok,1,,,,\n"
+        "4,adjacent,ok,,,,,\n"
+        "5,register,ok,0,,,,\n"
+        "6,register,rejected,,,,,\n"
+        "7,register,ok,1,,,,\n"
+        "8,register,ok,2,,,,\n"
+        "9,request,ok,0,0,0,0,0.00\n"
+        "10,request,ok,1,1,0,0,15.00\n"
+        "11,request,queued,,,,,\n"
+        "12,occupy,ok,0,,,,\n"
+        "13,cancel,invalid,0,,,,\n"
+        "14,release,ok,0,,,,\n"
+        "14,serve,ok,2,0,0,0,0.00\n"
+        "15,bogus,error,,,,,\n"
+        "16,rollback,ok,1,,,,\n";
+    
+    FILE* in = tmpfile();
+    FILE* out = tmpfile();
+    if (!in || !out) return false;
+    fputs(events, in);
+    rewind(in);
+    
+    ParkingSystem system;
+    ReplayEngine engine(system);
+    engine.run(in, out);
+    
+    std::string result;
+    char buffer[256];
+    rewind(out);
+    while (fgets(buffer, sizeof(buffer), out)) result += buffer;
+    fclose(in);
+    fclose(out);
+    
+    return result == expected && engine.getEventCount() == 15 &&
+           engine.getErrorCount() == 1 && system.findActiveRequest(1) == 1 &&
+           system.findActiveRequest(2) == -1;
+}
+
+bool TestRunner::testWaitingQueueDrain() {
+    // Three one-slot zones; only zone 0 lists a neighbour (zone 1)
+    ParkingSystem system;
+    int one[] = {1};
+    for (int z = 0; z < 3; z++) system.addZone("Z" + std::to_string(z), 1, one);
+    system.addAdjacency(0, 1);
+    for (int v = 0; v < 5; v++) system.addVehicle("W" + std::to_string(v), 0);
+    for (int v = 0; v < 3; v++) {
+        if (system.submitRequest(v, v) != v) return false;
+    }
+    if (system.submitRequest(3, 2) != REQUEST_QUEUED) return false;
+    if (system.submitRequest(4, 0) != REQUEST_QUEUED) return false;
+    
+    // A slot in zone 1 helps the zone-0 waiter, even though vehicle 3 is older
+    system.transitionRequest(1, CANCELLED);
+    const std::vector<int>& served = system.getServedFromQueue();
+    if (served.size() != 1) return false;
+    ParkingRequest* req = system.getRequest(served[0]);
+    if (req->getVehicleID() != 4 || req->getAllocatedZone() != 1) return false;
+    
+    // Nobody waits on zone 0 or its neighbours: the oldest waiter gets it
+    system.transitionRequest(0, CANCELLED);
+    if (system.getServedFromQueue().size() != 1) return false;
+    int third = system.getServedFromQueue()[0];
+    req = system.getRequest(third);
+    if (req->getVehicleID() != 3 || req->getAllocatedZone() != 0 || req->getPenalty() != 25.0f) {
+        return false;
+    }
+    
+    // The oldest waiter needs an EV slot, which a plain one cannot give:
+    // the next waiter in line gets it instead
+    int ev = system.addVehicle("WEV", 2, SLOT_EV);
+    int plain = system.addVehicle("W5", 2);
+    if (system.submitRequest(ev, 2) != REQUEST_QUEUED || system.submitRequest(plain, 2) != REQUEST_QUEUED) {
+        return false;
+    }
+    system.transitionRequest(third, CANCELLED);
+    if (system.getServedFromQueue().size() != 1) return false;
+    req = system.getRequest(system.getServedFromQueue()[0]);
+    int zone;
+    return req->getVehicleID() == plain && req->getAllocatedZone() == 0 &&
+           system.getQueuePosition(ev, zone) == 1;
+}
+
+bool TestRunner::testQueuePosition() {
+    // Two one-slot zones, both taken; 200 waiters alternate between them
+    ParkingSystem system;
+    int one[] = {1};
+    system.addZone("A", 1, one);
+    system.addZone("B", 1, one);
+    for (int v = 0; v < 202; v++) system.addVehicle("Q" + std::to_string(v), 0);
+    if (system.submitRequest(0, 0) != 0 || system.submitRequest(1, 1) != 1) return false;
+    for (int v = 2; v < 202; v++) {
+        if (system.submitRequest(v, v % 2) != REQUEST_QUEUED) return false;
+    }
+    
+    // Asking again must not put the vehicle in line twice
+    system.submitRequest(50, 0);
+    int zone = -1;
+    if (system.getQueuePosition(50, zone) != 25 || zone != 0) return false;
+    if (system.getQueuePosition(201, zone) != 100 || zone != 1) return false;
+    if (system.getQueuePosition(0, zone) != 0) return false;
+    
+    // Serving zone 1's head moves only zone 1's line forward
+    system.transitionRequest(1, CANCELLED);
+    if (system.getServedFromQueue().size() != 1) return false;
+    if (system.getRequest(system.getServedFromQueue()[0])->getVehicleID() != 3) return false;
+    if (system.getQueuePosition(3, zone) != 0) return false;
+    if (system.getQueuePosition(201, zone) != 99) return false;
+    return system.getQueuePosition(50, zone) == 25;
+}
+
+bool TestRunner::testHistoryLog() {
+    HistoryLog log;
+    int n = HISTORY_SEGMENT + 10;
+    for (int i = 0; i < n; i++) {
+        log.append(i, i, 0, i % 2, i % 3 == 0 ? RELEASED : ALLOCATED, (float)(i % 2) * 15);
+    }
+    if (log.getCount() != n || log.getSegmentCount() != 2 || log.getSealedCount() != 1) {
+        return false;
+    }
+    
+    long released = 0;
+    double penalty = 0;
+    for (int i = 0; i < n; i++) {
+        if (i % 3 == 0) {
+            released++;
+            penalty += (i % 2) * 15;
+        }
+    }
+    if (log.countState(RELEASED) != released || log.sumPenalty(RELEASED) != penalty) {
+        return false;
+    }
+    
+    // Only sealed segments can be written out; seal() closes the tail early
+    FILE* out = tmpfile();
+    if (!out) return false;
+    bool ok = log.writeSegment(0, out) && !log.writeSegment(1, out);
+    log.seal();
+    ok = ok && log.writeSegment(1, out) && log.getSealedCount() == 2;
+    long bytes = ftell(out);
+    fclose(out);
+    
+    log.append(n, n, 0, 0, ALLOCATED, 0);
+    return ok && log.getSegmentCount() == 3 && bytes == (long)(2 * sizeof(int)) + 29L * n;
+}
+
+bool TestRunner::testSnapshot() {
+    ParkingSystem system;
+    int caps[] = {2, 1};
+    system.addZone("North", 2, caps);
+    system.addZone("South", 1, caps + 1);
+    system.addAdjacency(0, 1);
+    for (int v = 0; v < 6; v++) system.addVehicle("SNAP" + std::to_string(v), v % 2);
+    for (int v = 0; v < 5; v++) system.submitRequest(v, 0);    // 4 park, 1 waits
+    system.transitionRequest(0, OCCUPIED);
+    system.transitionRequest(0, RELEASED);                      // vehicle 4 served
+    system.transitionRequest(1, CANCELLED);
+    system.submitRequest(5, 1);
+    system.submitRequest(1, 1);
+    
+    const char* path = "snapshot_test.bin";
+    if (!system.saveSnapshot(path)) return false;
+    
+    ParkingSystem loaded;
+    bool ok = loaded.loadSnapshot(path) && !loaded.loadSnapshot(path);
+    
+    // A snapshot from another layout version is refused
+    FILE* f = fopen(path, "r+b");
+    uint32_t version = SNAPSHOT_VERSION + 1;
+    if (f) {
+        fseek(f, 8, SEEK_SET);
+        fwrite(&version, sizeof(version), 1, f);
+        fclose(f);
+    }
+    ParkingSystem stale;
+    ok = ok && f && !stale.loadSnapshot(path);
+    
+    // A bad record in the last section applied is refused before anything
+    // is loaded, leaving the system empty and still able to load
+    ok = ok && system.saveSnapshot(path);
+    SnapHeader header;
+    int32_t badRequest = 1 << 30;
+    f = fopen(path, "r+b");
+    if (f) {
+        ok = ok && fread(&header, sizeof(header), 1, f) == 1 && header.sections[SNAP_ROLLBACK].count > 0;
+        fseek(f, (long)(header.sections[SNAP_ROLLBACK].offset + offsetof(SnapRollback, requestID)), SEEK_SET);
+        fwrite(&badRequest, sizeof(badRequest), 1, f);
+        fclose(f);
+    }
+    ok = ok && f && !stale.loadSnapshot(path) && stale.getZoneCount() == 0 &&
+         stale.getVehicleCount() == 0 && stale.getRequestCount() == 0;
+    
+    // So are records valid one by one that do not agree: a released
+    // request revived onto a slot someone else holds, an occupied slot
+    // with no active request, and a slot held for the wrong vehicle
+    auto refused = [&](int section, size_t offset, int32_t value) {
+        if (!system.saveSnapshot(path)) return false;
+        FILE* g = fopen(path, "r+b");
+        if (!g) return false;
+        SnapHeader h;
+        bool patched = fread(&h, sizeof(h), 1, g) == 1 && h.sections[section].count > 2 &&
+                       fseek(g, (long)(h.sections[section].offset + offset), SEEK_SET) == 0 &&
+                       fwrite(&value, sizeof(value), 1, g) == 1;
+        fclose(g);
+        ParkingSystem fresh;
+        return patched && !fresh.loadSnapshot(path) && fresh.getZoneCount() == 0;
+    };
+    size_t state = offsetof(SnapRequest, state);
+    ok = ok && refused(SNAP_REQUESTS, state, ALLOCATED) &&
+         refused(SNAP_REQUESTS, 2 * sizeof(SnapRequest) + state, RELEASED) &&
+         refused(SNAP_SLOTS, offsetof(SnapSlot, vehicleID), 5);
+    ok = ok && system.saveSnapshot(path) && stale.loadSnapshot(path);
+    remove(path);
+    if (!ok) return false;
+    
+    if (loaded.getZoneCount() != 2 || loaded.getVehicleCount() != 6 ||
+        loaded.getRequestCount() != system.getRequestCount()) {
+        return false;
+    }
+    for (int r = 0; r < system.getRequestCount(); r++) {
+        ParkingRequest* a = system.getRequest(r);
+        ParkingRequest* b = loaded.getRequest(r);
+        if (a->getState() != b->getState() || a->getAllocatedSlot() != b->getAllocatedSlot() ||
+            a->getAllocatedZone() != b->getAllocatedZone() || a->getPenalty() != b->getPenalty()) {
+            return false;
+        }
+    }
+    for (int v = 0; v < 6; v++) {
+        int za = -1, zb = -1;
+        if (system.findActiveRequest(v) != loaded.findActiveRequest(v) ||
+            system.getQueuePosition(v, za) != loaded.getQueuePosition(v, zb) || za != zb) {
+            return false;
+        }
+    }
+    if (loaded.findVehicleByPlate("SNAP3") != 3 ||
+        loaded.getStats().getCompleted() != 1 || loaded.getStats().getCancelled() != 1) {
+        return false;
+    }
+    
+    // The restored system keeps working: undoing the last allocation frees
+    // its slot for the first waiter
+    int waitZone = -1;
+    std::vector<int> undone;
+    loaded.rollbackOperations(1, &undone);
+    return undone.size() == 1 && loaded.getServedFromQueue().size() == 1 &&
+           loaded.getQueuePosition(5, waitZone) == 0;
+}
+
+bool TestRunner::testWriteAheadLog() {
+    const char* logPath = "wal_test.log";
+    const char* snapPath = "wal_test.snap";
+    remove(logPath);
+    int caps[] = {2};
+    
+    ParkingSystem system;
+    system.addZone("A", 1, caps);
+    system.addZone("B", 1, caps);
+    system.addAdjacency(0, 1);
+    WriteAheadLog wal;
+    if (!wal.open(logPath, 0, 4)) return false;
+    system.attachLog(&wal);
+    for (int v = 0; v < 6; v++) system.addVehicle("LOG" + std::to_string(v), 0);
+    for (int v = 0; v < 3; v++) system.submitRequest(v, 0);
+    // Nine frames fill two groups and start a third; each operation still
+    // commits before it returns, so none is left waiting for the group
+    if (wal.getLastSequence() != 9 || wal.getDurableSequence() != 9) return false;
+    if (!system.checkpoint(snapPath)) return false;
+    
+    // After the checkpoint: more traffic, a waiter served and a rollback
+    for (int v = 3; v < 6; v++) system.submitRequest(v, 0);
+    system.transitionRequest(0, OCCUPIED);
+    system.transitionRequest(0, RELEASED);
+    system.transitionRequest(1, CANCELLED);
+    system.rollbackOperations(1);
+    if (!wal.commit()) return false;
+    
+    // A crash halfway through the next group leaves a torn frame
+    FILE* f = fopen(logPath, "ab");
+    if (!f) return false;
+    fwrite("torn", 1, 4, f);
+    fclose(f);
+    
+    ParkingSystem recovered;
+    bool ok = recovered.loadSnapshot(snapPath) && recovered.replayLog(logPath) == 7 &&
+              recovered.replayLog(logPath) == 0 &&
+              recovered.getLogSequence() == system.getLogSequence() &&
+              recovered.getRequestCount() == system.getRequestCount();
+    for (int r = 0; ok && r < system.getRequestCount(); r++) {
+        ParkingRequest* a = system.getRequest(r);
+        ParkingRequest* b = recovered.getRequest(r);
+        ok = a->getState() == b->getState() && a->getAllocatedZone() == b->getAllocatedZone() &&
+             a->getAllocatedSlot() == b->getAllocatedSlot();
+    }
+    for (int v = 0; ok && v < 6; v++) {
+        int za = -1, zb = -1;
+        ok = system.findActiveRequest(v) == recovered.findActiveRequest(v) &&
+             system.getQueuePosition(v, za) == recovered.getQueuePosition(v, zb);
+    }
+    
+    // Reopening drops the torn bytes and numbering carries on
+    WriteAheadLog reopened;
+    ok = ok && reopened.open(logPath, recovered.getLogSequence()) &&
+         reopened.getLastSequence() == system.getLogSequence();
+    if (ok) {
+        recovered.attachLog(&reopened);
+        recovered.transitionRequest(2, OCCUPIED);
+        ok = reopened.commit() && recovered.getLogSequence() == system.getLogSequence() + 1;
+        reopened.close();
+        WalReader reader;
+        WalFrame frame;
+        ok = ok && reader.open(logPath);
+        while (ok && reader.next(frame)) {}
+        ok = ok && reader.getValidFrames() == 8;
+    }
+    
+#ifndef _WIN32
+    // A frame that cannot be written refuses the operation, and is not
+    // kept to be written by a later commit
+    WriteAheadLog full;
+    if (ok && full.open("/dev/full", 0, 1)) {
+        ParkingSystem refused;
+        refused.addZone("A", 1, caps);
+        refused.attachLog(&full);
+        ok = refused.addVehicle("FULL", 0) == -1 && refused.getVehicleCount() == 0 &&
+             full.getLastSequence() == 0 && !full.commit();
+    }
+#endif
+    
+    wal.close();
+    remove(logPath);
+    remove(snapPath);
+    return ok;
+}
+
+bool TestRunner::testRollbackJournal() {
+    RollbackManager journal;
+    int n = 3 * ROLLBACK_SEGMENT + 7;
+    for (int i = 0; i < n; i++) {
+        RollbackEntry entry(i, i % 1000, i % 7, i, REQUESTED);
+        entry.timestamp = TimeStamp::fromSeconds((time_t)(1700000000 + i));
+        if (!journal.push(entry)) return false;
+    }
+    RollbackEntry tooFar(0, 1 << 20, 0, 0, REQUESTED);
+    if (journal.push(tooFar) || journal.getSize() != n) return false;
+    
+    RollbackEntry e = journal.getEntry(1234);
+    if (e.requestID != 1234 || e.zone != 234 || e.area != 1234 % 7 || e.slot != 1234 ||
+        e.timestamp.getTime() != 1700000000 + 1234) {
+        return false;
+    }
+    
+    // Popping walks back down across segment boundaries
+    for (int i = n - 1; i >= n - ROLLBACK_SEGMENT - 10; i--) {
+        if (!journal.pop(e) || e.requestID != i) return false;
+    }
+    
+    // Retention keeps only the newest entries, including on later pushes
+    journal.setRetention(100);
+    if (journal.getSize() != 100 || journal.getEntry(0).requestID != n - ROLLBACK_SEGMENT - 110) {
+        return false;
+    }
+    RollbackEntry extra(n, 0, 0, 0, OCCUPIED);
+    journal.push(extra);
+    if (journal.getSize() != 100 || journal.getEntry(99).prevState != OCCUPIED) return false;
+    
+    int popped = 0;
+    while (journal.pop(e)) popped++;
+    return popped == 100 && journal.isEmpty();
+}
+
+bool TestRunner::testNearestFirstAllocation() {
+    // Zone 0 -> 1 -> 4 is a chain; zones 2 and 3 are not connected
+    ParkingSystem system;
+    int one[] = {1};
+    for (int z = 0; z < 5; z++) system.addZone("N" + std::to_string(z), 1, one);
+    system.addAdjacency(0, 1);
+    system.addAdjacency(1, 4);
+    for (int v = 0; v < 6; v++) system.addVehicle("NF" + std::to_string(v), 0);
+    
+    int expectZone[] = {0, 1, 4, 2, 3};
+    float expectPenalty[] = {0, 15, 25, 25, 25};
+    for (int v = 0; v < 5; v++) {
+        ParkingRequest* req = system.getRequest(system.submitRequest(v, 0));
+        if (!req || req->getAllocatedZone() != expectZone[v] || 
+            req->getPenalty() != expectPenalty[v]) {
+            return false;
+        }
+    }
+    
+    // A freed neighbour is found again and charged as a neighbour
+    if (system.submitRequest(5, 0) != REQUEST_QUEUED) return false;
+    system.transitionRequest(1, CANCELLED);
+    if (system.getServedFromQueue().size() != 1) return false;
+    ParkingRequest* served = system.getRequest(system.getServedFromQueue()[0]);
+    return served->getAllocatedZone() == 1 && served->getPenalty() == 15.0f;
+}
+
+bool TestRunner::testBatchAllocation() {
+    // Twin cities, one fed request by request and one in a single batch
+    ParkingSystem seq, bat;
+    ParkingSystem* systems[] = {&seq, &bat};
+    int caps[] = {2, 3};
+    for (ParkingSystem* s : systems) {
+        for (int z = 0; z < 6; z++) s->addZone("B" + std::to_string(z), 2, caps);
+        for (int z = 0; z < 5; z++) s->addAdjacency(z, z + 1);
+        for (int v = 0; v < 40; v++) s->addVehicle("BA" + std::to_string(v), v % 6);
+    }
+    
+    // Heavy on zone 2, with repeats, bad IDs and more cars than slots
+    std::vector<BatchRequest> batch;
+    for (int i = 0; i < 45; i++) batch.push_back(BatchRequest{i % 40, i % 3 == 0 ? 2 : i % 6});
+    batch.push_back(BatchRequest{99, 0});
+    batch.push_back(BatchRequest{1, 9});
+    
+    std::vector<int> results;
+    bat.submitBatch(batch, results);
+    if (results.size() != batch.size()) return false;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (seq.submitRequest(batch[i].vehicleID, batch[i].zone) != results[i]) return false;
+        if (results[i] < 0) continue;
+        ParkingRequest* a = seq.getRequest(results[i]);
+        ParkingRequest* b = bat.getRequest(results[i]);
+        if (a->getAllocatedZone() != b->getAllocatedZone() || 
+            a->getAllocatedArea() != b->getAllocatedArea() ||
+            a->getAllocatedSlot() != b->getAllocatedSlot() || 
+            a->getPenalty() != b->getPenalty()) {
+            return false;
+        }
+    }
+    
+    // Both queues hold the same vehicles, so a freed slot goes the same way
+    seq.transitionRequest(0, CANCELLED);
+    bat.transitionRequest(0, CANCELLED);
+    return seq.getServedFromQueue() == bat.getServedFromQueue() && 
+           !seq.getServedFromQueue().empty();
+}
+
+bool TestRunner::testMinPenaltyBatch() {
+    // Zones 0 and 1 are full. 0 borders 2 and 3, 1 borders only 2, so
+    // first fit sends the car for 0 to 2 and the car for 1 far away.
+    ParkingSystem greedy, optimal;
+    ParkingSystem* systems[] = {&greedy, &optimal};
+    int one[] = {1};
+    for (ParkingSystem* s : systems) {
+        for (int z = 0; z < 4; z++) s->addZone("M" + std::to_string(z), 1, one);
+        s->addAdjacency(0, 2);
+        s->addAdjacency(0, 3);
+        s->addAdjacency(1, 2);
+        for (int v = 0; v < 8; v++) s->addVehicle("MP" + std::to_string(v), 0);
+        s->submitRequest(0, 0);
+        s->submitRequest(1, 1);
+    }
+    std::vector<BatchRequest> batch = {{2, 0}, {3, 1}};
+    std::vector<int> a, b;
+    greedy.submitBatch(batch, a);
+    optimal.submitBatch(batch, b, BATCH_MIN_PENALTY);
+    if (greedy.getRequest(a[0])->getPenalty() + greedy.getRequest(a[1])->getPenalty() != 40.0f ||
+        optimal.getRequest(b[0])->getAllocatedZone() != 3 ||
+        optimal.getRequest(b[1])->getAllocatedZone() != 2 ||
+        optimal.getRequest(b[0])->getPenalty() + optimal.getRequest(b[1])->getPenalty() != 30.0f) {
+        return false;
+    }
+    
+    // Waiters left over when a zone opens are placed ahead of new arrivals
+    optimal.submitRequest(4, 0);
+    optimal.submitRequest(5, 1);
+    int two[] = {2};
+    optimal.addZone("M4", 1, two);
+    optimal.submitBatch({{6, 2}, {4, 0}}, b, BATCH_MIN_PENALTY);
+    int zone;
+    if (b[0] != REQUEST_QUEUED || b[1] != REQUEST_REJECTED || 
+        optimal.getServedFromQueue().size() != 2 || optimal.getQueuePosition(6, zone) != 1) {
+        return false;
+    }
+    
+    // Random city: never more penalty than first fit, never fewer placed
+    ParkingSystem r1, r2;
+    ParkingSystem* randoms[] = {&r1, &r2};
+    int caps[] = {3, 2};
+    for (ParkingSystem* s : randoms) {
+        for (int z = 0; z < 30; z++) s->addZone("R" + std::to_string(z), 2, caps);
+        for (int z = 0; z < 30; z++) {
+            s->addAdjacency(z, (z * 7 + 3) % 30);
+            s->addAdjacency(z, (z * 11 + 5) % 30);
+        }
+        for (int v = 0; v < 200; v++) s->addVehicle("RC" + std::to_string(v), 0);
+    }
+    batch.clear();
+    unsigned seed = 12345;
+    for (int v = 0; v < 160; v++) {
+        seed = seed * 1103515245u + 12345u;
+        batch.push_back(BatchRequest{v, (int)((seed >> 16) % 8) * 3});
+    }
+    r1.submitBatch(batch, a);
+    r2.submitBatch(batch, b, BATCH_MIN_PENALTY);
+    float p1 = 0, p2 = 0;
+    int placed1 = 0, placed2 = 0;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (a[i] >= 0) { p1 += r1.getRequest(a[i])->getPenalty(); placed1++; }
+        if (b[i] >= 0) { p2 += r2.getRequest(b[i])->getPenalty(); placed2++; }
+    }
+    if (placed1 != 150 || placed2 != 150 || p2 > p1) return false;
+    
+    // Replay repeats the batch as a whole
+    const char* logPath = "batch_test.log";
+    remove(logPath);
+    ParkingSystem logged, recovered;
+    WriteAheadLog wal;
+    if (!wal.open(logPath)) return false;
+    logged.attachLog(&wal);
+    for (ParkingSystem* s : {&logged, &recovered}) {
+        for (int z = 0; z < 4; z++) s->addZone("M" + std::to_string(z), 1, one);
+        s->addAdjacency(0, 2);
+        s->addAdjacency(0, 3);
+        s->addAdjacency(1, 2);
+    }
+    for (int v = 0; v < 4; v++) logged.addVehicle("MP" + std::to_string(v), 0);
+    logged.submitRequest(0, 0);
+    logged.submitRequest(1, 1);
+    logged.submitBatch({{2, 0}, {3, 1}}, b, BATCH_MIN_PENALTY);
+    wal.close();
+    bool ok = recovered.replayLog(logPath) == 9 && 
+              recovered.getRequestCount() == logged.getRequestCount();
+    for (int r = 0; ok && r < logged.getRequestCount(); r++) {
+        ok = recovered.getRequest(r)->getAllocatedZone() == logged.getRequest(r)->getAllocatedZone();
+    }
+    remove(logPath);
+    return ok;
+}
+
+bool TestRunner::testTimeStamp() {
+    // Never goes backwards, and two reads in a row are not stuck on a second
+    TimeStamp first;
+    TimeStamp prev = first;
+    for (int i = 0; i < 100000; i++) {
+        TimeStamp t;
+        if (t < prev) return false;
+        prev = t;
+    }
+    if (!(first < prev) || first.getHoursDiff(prev) <= 0) return false;
+    
+    // Cached formatting agrees with localtime() across an hour boundary
+    time_t base = 1700000000 - 1700000000 % 3600 + 3590;
+    for (time_t sec = base; sec < base + 20; sec++) {
+        tm* local = localtime(&sec);
+        char expect[TIME_TEXT_SIZE];
+        snprintf(expect, sizeof(expect), "%02d:%02d:%02d", local->tm_hour, local->tm_min, local->tm_sec);
+        if (TimeStamp::fromNanos((int64_t)sec * 1000000000LL + 999).toString() != expect) return false;
+    }
+    
+    // A stay shorter than a second still has a duration
+    ParkingSystem system;
+    int caps[] = {1};
+    system.addZone("T", 1, caps);
+    system.addVehicle("TIME1", 0);
+    int rID = system.submitRequest(0, 0);
+    system.transitionRequest(rID, OCCUPIED);
+    system.transitionRequest(rID, RELEASED);
+    return system.getRequest(rID)->getDuration() > 0;
+}
+
+bool TestRunner::testShardedSystem() {
+    // Eight zones in a line, two slots each, two zones per shard
+    ShardedParkingSystem city;
+    int two[] = {2};
+    for (int z = 0; z < 8; z++) city.addZone("S" + std::to_string(z), 1, two);
+    for (int z = 0; z < 7; z++) {
+        city.addAdjacency(z, z + 1);
+        city.addAdjacency(z + 1, z);
+    }
+    if (!city.start(4) || city.getShardOf(1) != 0 || city.getShardOf(2) != 1) return false;
+    
+    // Zone 1 fills, then its neighbour 0 on the same shard, then its
+    // neighbour 2, which another shard has to grant
+    std::vector<BatchRequest> batch;
+    for (int v = 0; v < 5; v++) batch.push_back(BatchRequest{v, 1});
+    std::vector<int> rIDs;
+    std::vector<BatchResult> placed;
+    city.submitAll(batch, rIDs, placed);
+    int expectZone[] = {1, 1, 0, 0, 2};
+    float expectPenalty[] = {0, 0, 15, 15, 15};
+    for (int i = 0; i < 5; i++) {
+        if (rIDs[i] < 0 || placed[i].zone != expectZone[i] || placed[i].penalty != expectPenalty[i]) {
+            return false;
+        }
+    }
+    
+    // The rest of the city: every slot handed out once, then REQUEST_FULL
+    batch.clear();
+    for (int v = 5; v < 20; v++) batch.push_back(BatchRequest{v, v % 8});
+    std::vector<int> more;
+    std::vector<BatchResult> morePlaced;
+    city.submitAll(batch, more, morePlaced);
+    std::vector<int> seen(16, 0);
+    int full = 0;
+    for (int i = 0; i < 5; i++) seen[placed[i].zone * 2 + placed[i].slot]++;
+    for (size_t i = 0; i < more.size(); i++) {
+        if (more[i] == REQUEST_FULL) full++;
+        else if (more[i] >= 0) seen[morePlaced[i].zone * 2 + morePlaced[i].slot]++;
+    }
+    for (int k = 0; k < 16; k++) if (seen[k] != 1) return false;
+    if (full != 4) return false;
+    
+    // Cancelling on the home shard frees the slot on its zone's shard
+    if (city.transitionRequest(rIDs[4], ALLOCATED) || city.transitionRequest(rIDs[4], REQUESTED) ||
+        !city.transitionRequest(rIDs[4], CANCELLED) || city.transitionRequest(rIDs[4], OCCUPIED)) {
+        return false;
+    }
+    
+    // Idle, the shards sleep rather than spin, and wake for the next
+    // request and the grant it needs from another shard
+    std::clock_t cpu = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    cpu = std::clock() - cpu;
+    int rID = city.submitRequest(30, 3);
+    city.stop();
+    ParkingRequest* req = city.getRequest(rID);
+    return cpu < CLOCKS_PER_SEC / 4 && req && req->getAllocatedZone() == 2 &&
+           req->getPenalty() == 15.0f && city.getRequest(rIDs[4])->getState() == CANCELLED &&
+           city.getZone(2)->getAvailable() == 0;
+}
+
+// Pipeline callback: tallies results by kind
+static void countResult(void* context, int result) {
+    std::atomic<int>* counts = static_cast<std::atomic<int>*>(context);
+    counts[result >= 0 ? 0 : (result == REQUEST_QUEUED ? 1 : 2)]++;
+}
+
+bool TestRunner::testRequestPipeline() {
+    const char* logPath = "pipeline_test.log";
+    remove(logPath);
+    ParkingSystem system;
+    int caps[] = {10, 10};
+    for (int z = 0; z < 5; z++) system.addZone("P" + std::to_string(z), 2, caps);
+    for (int v = 0; v < 200; v++) system.addVehicle("PIPE" + std::to_string(v), 0);
+    WriteAheadLog wal;
+    if (!wal.open(logPath, 0, 1 << 20)) return false;
+    system.attachLog(&wal);
+    
+    // Four terminals post 50 arrivals each for 100 slots
+    RequestPipeline pipeline(system, &wal, 64);
+    std::atomic<int> counts[3] = {{0}, {0}, {0}};
+    if (!pipeline.start()) return false;
+    std::vector<std::thread> terminals;
+    for (int t = 0; t < 4; t++) {
+        terminals.push_back(std::thread([&pipeline, &counts, t]() {
+            for (int i = 0; i < 50; i++) {
+                while (!pipeline.post(PIPE_SUBMIT, t * 50 + i, i % 5, countResult, counts)) {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < terminals.size(); t++) terminals[t].join();
+    
+    // A future sees the effects of everything posted before it
+    std::future<int> cancel = pipeline.transitionAsync(0, CANCELLED);
+    if (cancel.get() != 1) return false;
+    pipeline.stop();
+    
+    bool ok = counts[0] == 100 && counts[1] == 100 && counts[2] == 0 &&
+              pipeline.getEventCount() == 201 && pipeline.getLatency().getCount() == 201 &&
+              pipeline.getLatency().percentile(50) <= pipeline.getLatency().getMax() &&
+              system.getServedFromQueue().size() == 1 &&
+              wal.getDurableSequence() == wal.getLastSequence();
+    ok = ok && pipeline.submitAsync(0, 0).get() == PIPELINE_FULL;
+    
+    // Restarted, it carries on where it left off
+    ok = ok && pipeline.start() && pipeline.rollbackAsync(1).get() == 1;
+    pipeline.stop();
+    wal.close();
+    remove(logPath);
+    
+#ifndef _WIN32
+    // A batch the log cannot commit is not reported as done
+    ParkingSystem unlogged;
+    int two[] = {2};
+    unlogged.addZone("U", 1, two);
+    unlogged.addVehicle("UNLOGGED", 0);
+    WriteAheadLog full;
+    if (ok && full.open("/dev/full", 0, 64)) {
+        unlogged.attachLog(&full);
+        RequestPipeline failing(unlogged, &full);
+        ok = failing.start() && failing.submitAsync(0, 0).get() == PIPELINE_UNLOGGED &&
+             failing.getFailedCommitCount() == 1 && full.getDurableSequence() == 0;
+        failing.stop();
+    }
+#endif
+    
+    // Idle, the engine sleeps rather than spins, and wakes when the hold
+    // it is waiting on times out
+    ParkingSystem quiet;
+    int one[] = {1};
+    quiet.addZone("Q", 1, one);
+    quiet.addVehicle("QUIET", 0);
+    quiet.setHoldTimeout(1);
+    RequestPipeline idle(quiet);
+    int rID = ok && idle.start() ? idle.submitAsync(0, 0).get() : -1;
+    std::clock_t cpu = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    cpu = std::clock() - cpu;
+    idle.stop();
+    return ok && rID >= 0 && quiet.getRequest(rID)->getState() == CANCELLED &&
+           cpu < CLOCKS_PER_SEC / 4;
+}
+
+bool TestRunner::testHoldExpiry() {
+    // The wheel fires on the exact tick, across levels and past the
+    // overflow, and a cancelled timer never fires
+    TimerWheel wheel(1000);
+    int64_t due[] = {1000, 1063, 1064, 5000, 300000, 1000 + (1LL << 40)};
+    for (int id = 0; id < 6; id++) wheel.arm(id, due[id]);
+    wheel.arm(6, 4000);
+    if (!wheel.cancel(6) || wheel.cancel(6) || wheel.getArmedCount() != 6) return false;
+    std::vector<int> fired;
+    for (int id = 0; id < 6; id++) {
+        wheel.advance(due[id] - 1, fired);
+        if ((int)fired.size() != id) return false;
+        wheel.advance(due[id], fired);
+        if ((int)fired.size() != id + 1 || fired[id] != id) return false;
+    }
+    if (wheel.getArmedCount() != 0) return false;
+    
+    // One zone of two slots; the third vehicle waits
+    ParkingSystem system;
+    int two[] = {2};
+    system.addZone("Hold", 1, two);
+    for (int v = 0; v < 4; v++) system.addVehicle("H" + std::to_string(v), 0);
+    system.setHoldTimeout(60);
+    int r0 = system.submitRequest(0, 0), r1 = system.submitRequest(1, 0);
+    if (r0 < 0 || r1 < 0 || system.submitRequest(2, 0) != REQUEST_QUEUED) return false;
+    if (system.getHoldCount() != 2 || !system.transitionRequest(r1, OCCUPIED)) return false;
+    if (system.getHoldCount() != 1) return false;
+    
+    // Before the timeout nothing happens; after it the unclaimed hold is
+    // cancelled, its slot goes to the waiter, and the new hold is timed
+    int64_t start = system.getRequest(r0)->getAllocationTime().getNanos();
+    std::vector<int> expired;
+    if (system.expireHolds(TimeStamp::fromNanos(start + 59000000000LL), &expired) != 0) {
+        return false;
+    }
+    if (system.expireHolds(TimeStamp::fromNanos(start + 61000000000LL), &expired) != 1) {
+        return false;
+    }
+    if (expired.size() != 1 || expired[0] != r0 || system.getRequest(r0)->getState() != CANCELLED) {
+        return false;
+    }
+    const std::vector<int>& served = system.getServedFromQueue();
+    if (served.size() != 1 || system.getRequest(served[0])->getVehicleID() != 2) return false;
+    if (system.getRequest(r1)->getState() != OCCUPIED || system.getHoldCount() != 1) return false;
+    
+    // A rolled-back allocation drops its timer, and with no timeout
+    // nothing is timed
+    if (system.rollbackOperations(1) != 1 || system.getHoldCount() != 0) return false;
+    system.setHoldTimeout(0);
+    if (system.submitRequest(3, 0) < 0 || system.getHoldCount() != 0) return false;
+    return system.expireHolds(TimeStamp::fromNanos(start + 3600000000000LL)) == 0;
+}
+
+bool TestRunner::testOccupancyForecast() {
+    // Three arrivals in one minute: once it closes the rate is 30% of
+    // them, and two empty minutes decay it twice more
+    OccupancyForecaster rates;
+    rates.addZone();
+    int64_t minute = 60000000000LL, t0 = 1000 * minute;
+    for (int i = 0; i < 3; i++) rates.recordArrival(0, TimeStamp::fromNanos(t0 + i));
+    rates.recordDeparture(0, TimeStamp::fromNanos(t0 + 1));
+    float now = rates.getArrivalRate(0, TimeStamp::fromNanos(t0 + minute));
+    float later = rates.getArrivalRate(0, TimeStamp::fromNanos(t0 + 3 * minute));
+    if (now < 0.89f || now > 0.91f || later < 0.43f || later > 0.45f) return false;
+    if (rates.getArrivalRate(0, TimeStamp::fromNanos(t0)) != 0) return false;
+    // Net +0.6 a minute over ten minutes, capped at capacity
+    float ahead = rates.predict(0, 2, 20, 10, TimeStamp::fromNanos(t0 + minute));
+    if (ahead < 7.9f || ahead > 8.1f || rates.predict(0, 2, 5, 10, TimeStamp::fromNanos(t0 + minute)) != 5) {
+        return false;
+    }
+    
+    // Zone 0 (one slot) has neighbours 1 and 2 with four slots each
+    ParkingSystem system;
+    int one[] = {1}, four[] = {4};
+    system.addZone("Centre", 1, one);
+    system.addZone("North", 1, four);
+    system.addZone("South", 1, four);
+    system.addAdjacency(0, 1);
+    system.addAdjacency(0, 2);
+    for (int v = 0; v < 4; v++) system.addVehicle("F" + std::to_string(v), 0);
+    int r0 = system.submitRequest(0, 0);
+    if (r0 < 0 || system.getRequest(r0)->getAllocatedZone() != 0) return false;
+    
+    // North has been taking 5 cars a minute: it fills in ten minutes,
+    // so overflow from the centre goes south at the same penalty
+    TimeStamp stamp;
+    for (int i = 0; i < 5; i++) {
+        system.getForecaster().recordArrival(1, TimeStamp::fromNanos(stamp.getNanos() - 2 * minute));
+    }
+    system.setForecastHorizon(10);
+    std::vector<float> expected;
+    system.forecastOccupancy(10, expected);
+    if (expected.size() != 3 || expected[0] != 1 || expected[1] < FILLING_THRESHOLD || 
+        expected[2] != 0) {
+        return false;
+    }
+    int r1 = system.submitRequest(1, 0);
+    if (r1 < 0 || system.getRequest(r1)->getAllocatedZone() != 2 || 
+        system.getRequest(r1)->getPenalty() != 15) {
+        return false;
+    }
+    std::vector<BatchRequest> batch(1, BatchRequest{2, 0});
+    std::vector<int> results;
+    system.submitBatch(batch, results);
+    if (results[0] < 0 || system.getRequest(results[0])->getAllocatedZone() != 2) return false;
+    
+    // With steering off, route order again
+    system.setForecastHorizon(0);
+    int r3 = system.submitRequest(3, 0);
+    if (r3 < 0 || system.getRequest(r3)->getAllocatedZone() != 1) return false;
+    
+    // North, with ten slots, is forecast 6.3 cars fuller in ten minutes:
+    // it starts unmarked, and a batch marks it part way through, as
+    // requests submitted one by one would
+    ParkingSystem burst;
+    int ten[] = {10};
+    burst.addZone("Centre", 1, one);
+    burst.addZone("North", 1, ten);
+    burst.addZone("South", 1, ten);
+    burst.addAdjacency(0, 1);
+    burst.addAdjacency(0, 2);
+    for (int v = 0; v < 7; v++) burst.addVehicle("FB" + std::to_string(v), 0);
+    burst.submitRequest(0, 0);
+    for (int i = 0; i < 3; i++) {
+        burst.getForecaster().recordArrival(1, TimeStamp::fromNanos(stamp.getNanos() - 2 * minute));
+    }
+    burst.setForecastHorizon(10);
+    batch.clear();
+    for (int v = 1; v < 7; v++) batch.push_back(BatchRequest{v, 0});
+    burst.submitBatch(batch, results);
+    if (results[0] < 0 || burst.getRequest(results[0])->getAllocatedZone() != 1 ||
+        results[5] < 0 || burst.getRequest(results[5])->getAllocatedZone() != 2) {
+        return false;
+    }
+    
+    // Twin cities under the same forecast, one fed a batch and one the
+    // same requests in turn. The compact car in the middle splits the
+    // batch into two runs, each planned from the marks the last one left.
+    ParkingSystem seq, bat;
+    ParkingSystem* twins[] = {&seq, &bat};
+    for (ParkingSystem* s : twins) {
+        s->addZone("Centre", 1, one);
+        s->addZone("North", 1, ten);
+        s->addZone("South", 1, ten);
+        s->addAdjacency(0, 1);
+        s->addAdjacency(0, 2);
+        for (int v = 0; v < 10; v++) {
+            s->addVehicle("FT" + std::to_string(v), 0, v == 4 ? SLOT_COMPACT : 0);
+        }
+        s->submitRequest(0, 0);
+        for (int i = 0; i < 3; i++) {
+            s->getForecaster().recordArrival(1, TimeStamp::fromNanos(stamp.getNanos() - 2 * minute));
+        }
+        s->setForecastHorizon(10);
+    }
+    batch.clear();
+    for (int v = 1; v < 10; v++) batch.push_back(BatchRequest{v, 0});
+    bat.submitBatch(batch, results);
+    bool steered = false;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (seq.submitRequest(batch[i].vehicleID, batch[i].zone) != results[i]) return false;
+        if (results[i] < 0) return false;
+        ParkingRequest* a = seq.getRequest(results[i]);
+        ParkingRequest* b = bat.getRequest(results[i]);
+        if (a->getAllocatedZone() != b->getAllocatedZone() || 
+            a->getAllocatedSlot() != b->getAllocatedSlot()) {
+            return false;
+        }
+        steered = steered || b->getAllocatedZone() == 2;
+    }
+    return steered;
+}
+
+bool TestRunner::testSlotAttributes() {
+    // Compact vehicles may take plain slots; nobody else takes a compact,
+    // EV or accessible slot, and oversize needs an oversize slot
+    if (!slotFits(0, 0) || !slotFits(SLOT_COMPACT, SLOT_COMPACT) || !slotFits(0, SLOT_COMPACT) ||
+        slotFits(SLOT_COMPACT, 0) || slotFits(SLOT_EV, 0) || slotFits(0, SLOT_OVERSIZE) ||
+        !slotFits(SLOT_OVERSIZE, SLOT_OVERSIZE) || slotFits(SLOT_EV, SLOT_OVERSIZE)) {
+        return false;
+    }
+    
+    // Home has two plain slots; its neighbour has one plain, one
+    // accessible, one EV and one oversize slot, which anyone may take
+    ParkingSystem system;
+    int two[] = {2}, four[] = {4};
+    system.addZone("Home", 1, two);
+    system.addZone("Next", 1, four);
+    system.addAdjacency(0, 1);
+    if (!system.setSlotAttributes(1, 0, 1, SLOT_ACCESSIBLE) ||
+        !system.setSlotAttributes(1, 0, 2, SLOT_EV) ||
+        !system.setSlotAttributes(1, 0, 3, SLOT_OVERSIZE) ||
+        system.setSlotAttributes(1, 0, 4, SLOT_EV) || system.addVehicle("BAD", 0, SLOT_CLASSES) >= 0) {
+        return false;
+    }
+    Zone* next = system.getZone(1);
+    if (next->getAvailable() != 4 || next->getAvailableFor(0) != 2 ||
+        next->getAvailableFor(SLOT_EV) != 1 || next->getAvailableFor(SLOT_ACCESSIBLE) != 1 ||
+        next->getAvailableFor(SLOT_OVERSIZE) != 1 || next->getAvailableFor(SLOT_EV | SLOT_OVERSIZE) != 0) {
+        return false;
+    }
+    
+    int ev = system.addVehicle("EV", 0, SLOT_EV);
+    int big = system.addVehicle("BIG", 0, SLOT_OVERSIZE);
+    int bigger = system.addVehicle("BIGGER", 0, SLOT_OVERSIZE);
+    int plain[4];
+    for (int v = 0; v < 4; v++) plain[v] = system.addVehicle("P" + std::to_string(v), 0);
+    if (system.getVehicleNeeds(ev) != SLOT_EV || system.getVehicleNeeds(plain[0]) != 0) return false;
+    
+    // The EV car passes over home for the neighbour's EV slot
+    int rEV = system.submitRequest(ev, 0);
+    if (rEV < 0 || system.getRequest(rEV)->getAllocatedZone() != 1 ||
+        system.getRequest(rEV)->getAllocatedSlot() != 2 || next->getAvailableFor(SLOT_EV) != 0) {
+        return false;
+    }
+    int rBig = system.submitRequest(big, 0);
+    if (rBig < 0 || system.getRequest(rBig)->getAllocatedSlot() != 3) return false;
+    
+    // Plain cars fill the three plain slots, then wait rather than take
+    // the accessible one
+    int rPlain = -1;
+    for (int v = 0; v < 3; v++) {
+        rPlain = system.submitRequest(plain[v], 0);
+        if (rPlain < 0) return false;
+    }
+    if (system.getRequest(rPlain)->getAllocatedSlot() != 0) return false;
+    if (system.submitRequest(bigger, 0) != REQUEST_QUEUED ||
+        system.submitRequest(plain[3], 0) != REQUEST_QUEUED ||
+        next->getAvailable() != 1 || next->getAvailableFor(SLOT_ACCESSIBLE) != 1) {
+        return false;
+    }
+    
+    // A plain slot freeing up passes over the oversize car at the head of
+    // the queue; the oversize slot then goes to it
+    if (!system.transitionRequest(rPlain, CANCELLED)) return false;
+    const std::vector<int>& served = system.getServedFromQueue();
+    if (served.size() != 1 || system.getRequest(served[0])->getVehicleID() != plain[3]) return false;
+    if (!system.transitionRequest(rBig, OCCUPIED) || !system.transitionRequest(rBig, RELEASED)) {
+        return false;
+    }
+    if (served.size() != 1 || system.getRequest(served[0])->getVehicleID() != bigger ||
+        system.getRequest(served[0])->getAllocatedSlot() != 3) {
+        return false;
+    }
+    
+    // Requirements and attributes survive a snapshot
+    const char* path = "attributes_test.bin";
+    ParkingSystem loaded;
+    bool ok = system.saveSnapshot(path) && loaded.loadSnapshot(path);
+    remove(path);
+    if (!ok || loaded.getVehicleNeeds(bigger) != SLOT_OVERSIZE ||
+        loaded.getZone(1)->getSlotAttributes(0, 2) != SLOT_EV) {
+        return false;
+    }
+    Zone* copy = loaded.getZone(1);
+    if (copy->getAvailable() != 1 || copy->getAvailableFor(SLOT_ACCESSIBLE) != 1 ||
+        copy->getAvailableFor(SLOT_EV) != 0 || copy->getAvailableFor(0) != 0) {
+        return false;
+    }
+    
+    // A batch mixing requirements takes request IDs in arrival order, so
+    // replay, which repeats it request by request, cancels the same one
+    const char* logPath = "attributes_test.log";
+    remove(logPath);
+    ParkingSystem logged, recovered;
+    WriteAheadLog wal;
+    if (!wal.open(logPath)) return false;
+    logged.attachLog(&wal);
+    for (ParkingSystem* s : {&logged, &recovered}) {
+        s->addZone("Mixed", 1, four);
+        s->setSlotAttributes(0, 0, 1, SLOT_EV);
+    }
+    int car = logged.addVehicle("CAR", 0), charger = logged.addVehicle("CHARGER", 0, SLOT_EV);
+    std::vector<int> results;
+    logged.submitBatch({{car, 0}, {charger, 0}}, results);
+    ok = results.size() == 2 && results[0] == 0 && results[1] == 1 &&
+         logged.transitionRequest(results[1], CANCELLED);
+    wal.close();
+    ok = ok && recovered.replayLog(logPath) == 5 &&
+         recovered.getRequestCount() == logged.getRequestCount();
+    for (int r = 0; ok && r < logged.getRequestCount(); r++) {
+        ParkingRequest* want = logged.getRequest(r);
+        ParkingRequest* got = recovered.getRequest(r);
+        ok = got->getVehicleID() == want->getVehicleID() && got->getState() == want->getState() &&
+             got->getAllocatedSlot() == want->getAllocatedSlot();
+    }
+    remove(logPath);
+    return ok && recovered.getZone(0)->getAvailableFor(SLOT_EV) == 1;
+}
+
 void TestRunner::runTests() {
     std::cout << "AUTOMATED SYSTEM TESTS\n";
     std::cout << "================================================================\n";
@@ -62,11 +1391,11 @@ void TestRunner::runTests() {
     else { std::cout << "FAILED\n"; failed++; }
     
     std::cout << "Test 4: Cancellation from REQUESTED... ";
-    if (testCancellation()) { std::cout << "PASSED\n"; passed++; } 
+    if (testCancelRequested()) { std::cout << "PASSED\n"; passed++; } 
     else { std::cout << "FAILED\n"; failed++; }
     
     std::cout << "Test 5: Cancellation from ALLOCATED... ";
-    if (testCancellation()) { std::cout << "PASSED\n"; passed++; } 
+    if (testCancelAllocated()) { std::cout << "PASSED\n"; passed++; } 
     else { std::cout << "FAILED\n"; failed++; }
     
     std::cout << "Test 6: Rollback Single Operation... ";
@@ -89,6 +1418,82 @@ void TestRunner::runTests() {
     if (testZoneUtilization()) { std::cout << "PASSED\n"; passed++; } 
     else { std::cout << "FAILED\n"; failed++; }
     
+    std::cout << "Test 11: Active Request Index... ";
+    if (testActiveRequestIndex()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 12: License Plate Index... ";
+    if (testPlateIndex()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 13: Concurrent Allocation Stress... ";
+    if (testConcurrentAllocation()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 14: Headless Event Replay... ";
+    if (testReplay()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 15: Waiting Queue Drain... ";
+    if (testWaitingQueueDrain()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 16: Waiting Queue Position... ";
+    if (testQueuePosition()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 17: Columnar History Log... ";
+    if (testHistoryLog()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 18: Snapshot Save and Load... ";
+    if (testSnapshot()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 19: Write-Ahead Log Recovery... ";
+    if (testWriteAheadLog()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 20: Segmented Rollback Journal... ";
+    if (testRollbackJournal()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 21: Nearest-First Allocation... ";
+    if (testNearestFirstAllocation()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 22: Batch Allocation... ";
+    if (testBatchAllocation()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 23: Min-Penalty Batch... ";
+    if (testMinPenaltyBatch()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 24: Monotonic Timestamps... ";
+    if (testTimeStamp()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 25: Sharded Allocation... ";
+    if (testShardedSystem()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 26: Async Request Pipeline... ";
+    if (testRequestPipeline()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 27: Hold Timeout Expiry... ";
+    if (testHoldExpiry()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 28: Occupancy Forecast... ";
+    if (testOccupancyForecast()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
+    std::cout << "Test 29: Slot Attribute Matching... ";
+    if (testSlotAttributes()) { std::cout << "PASSED\n"; passed++; } 
+    else { std::cout << "FAILED\n"; failed++; }
+    
     std::cout << "\nTest Results:\n";
     std::cout << "================================================================\n";
     std::cout << "Passed: " << passed << "\n";
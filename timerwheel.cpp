@@ -0,0 +1,181 @@
+#include "TimerWheel.h"
+#include "Bitmap.h"
+
+static const int64_t SLOT_MASK = WHEEL_SLOTS - 1;
+static const int OVERFLOW_SLOT = WHEEL_LEVELS * WHEEL_SLOTS;     // past the last level
+static const int NONE = -1;
+
+TimerWheel::TimerWheel(int64_t start) {
+    reset(start);
+}
+
+void TimerWheel::reset(int64_t start) {
+    next.clear();
+    prev.clear();
+    slotOf.clear();
+    deadline.clear();
+    for (int i = 0; i <= OVERFLOW_SLOT; i++) head[i] = NONE;
+    for (int l = 0; l < WHEEL_LEVELS; l++) occupied[l] = 0;
+    current = start;
+    armed = 0;
+}
+
+// Lowest level whose current chunk holds the deadline; past deadlines go
+// in the slot for the current tick
+void TimerWheel::place(int id) {
+    int64_t when = deadline[id] < current ? current : deadline[id];
+    int64_t diff = when ^ current;
+    int slot = OVERFLOW_SLOT;
+    for (int l = 0; l < WHEEL_LEVELS; l++) {
+        if ((diff >> (WHEEL_BITS * (l + 1))) == 0) {
+            slot = l * WHEEL_SLOTS + (int)((when >> (WHEEL_BITS * l)) & SLOT_MASK);
+            occupied[l] |= 1ULL << (slot & SLOT_MASK);
+            break;
+        }
+    }
+    slotOf[id] = slot;
+    prev[id] = NONE;
+    next[id] = head[slot];
+    if (head[slot] != NONE) prev[head[slot]] = id;
+    head[slot] = id;
+}
+
+void TimerWheel::unlink(int id) {
+    int slot = slotOf[id];
+    if (prev[id] != NONE) next[prev[id]] = next[id];
+    else head[slot] = next[id];
+    if (next[id] != NONE) prev[next[id]] = prev[id];
+    if (head[slot] == NONE && slot < OVERFLOW_SLOT) {
+        occupied[slot / WHEEL_SLOTS] &= ~(1ULL << (slot & SLOT_MASK));
+    }
+    slotOf[id] = NONE;
+}
+
+// Empties a level-0 slot into out
+void TimerWheel::takeSlot(int slot, std::vector<int>& out) {
+    for (int id = head[slot]; id != NONE; id = next[id]) {
+        slotOf[id] = NONE;
+        out.push_back(id);
+        armed--;
+    }
+    head[slot] = NONE;
+    occupied[0] &= ~(1ULL << slot);
+}
+
+// The clock has entered this slot's span: spread its timers over the
+// levels below
+void TimerWheel::cascade(int slot) {
+    int id = head[slot];
+    head[slot] = NONE;
+    if (slot < OVERFLOW_SLOT) occupied[slot / WHEEL_SLOTS] &= ~(1ULL << (slot & SLOT_MASK));
+    while (id != NONE) {
+        int after = next[id];
+        place(id);
+        id = after;
+    }
+}
+
+void TimerWheel::arm(int id, int64_t when) {
+    if (id < 0) return;
+    if (id >= (int)slotOf.size()) {
+        next.resize(id + 1, NONE);
+        prev.resize(id + 1, NONE);
+        slotOf.resize(id + 1, NONE);
+        deadline.resize(id + 1, -1);
+    }
+    if (slotOf[id] != NONE) unlink(id);
+    else armed++;
+    deadline[id] = when;
+    place(id);
+}
+
+bool TimerWheel::cancel(int id) {
+    if (!isArmed(id)) return false;
+    unlink(id);
+    armed--;
+    return true;
+}
+
+bool TimerWheel::isArmed(int id) {
+    return id >= 0 && id < (int)slotOf.size() && slotOf[id] != NONE;
+}
+
+int64_t TimerWheel::getDeadline(int id) {
+    return isArmed(id) ? deadline[id] : -1;
+}
+
+int TimerWheel::getArmedCount() { return armed; }
+int64_t TimerWheel::getCurrent() { return current; }
+
+// Every occupied slot starts at or after current: level 0 holds only the
+// current block, and a level-l timer's digit there is past current's
+int64_t TimerWheel::nextTick() {
+    if (armed == 0) return -1;
+    if (occupied[0]) {
+        int64_t tick = (current & ~SLOT_MASK) | lowestSetBit(occupied[0]);
+        return tick > current ? tick : current;
+    }
+    for (int l = 1; l < WHEEL_LEVELS; l++) {
+        if (occupied[l] == 0) continue;
+        int shift = WHEEL_BITS * l;
+        return ((current >> (shift + WHEEL_BITS)) << (shift + WHEEL_BITS)) |
+               ((int64_t)lowestSetBit(occupied[l]) << shift);
+    }
+    int shift = WHEEL_BITS * WHEEL_LEVELS;
+    return ((current >> shift) + 1) << shift;
+}
+
+// Within a level-0 block the due slots are fired by bit scan. Crossing
+// into the next block cascades the level-1 slot now current, and any
+// level whose digit just wrapped to 0 cascades the level above it too.
+// With level 0 empty, the clock jumps to the next occupied slot of the
+// lowest non-empty level, or past to when there is none before it.
+void TimerWheel::advance(int64_t to, std::vector<int>& expired) {
+    while (current <= to) {
+        if (occupied[0] == 0) {
+            int level = 1;
+            while (level < WHEEL_LEVELS && occupied[level] == 0) level++;
+            int shift = WHEEL_BITS * level;
+            int64_t target;
+            int slot;
+            if (level < WHEEL_LEVELS) {
+                int digit = lowestSetBit(occupied[level]);
+                target = ((current >> (shift + WHEEL_BITS)) << (shift + WHEEL_BITS)) |
+                         ((int64_t)digit << shift);
+                slot = level * WHEEL_SLOTS + digit;
+            } else if (head[OVERFLOW_SLOT] != NONE) {
+                target = ((current >> shift) + 1) << shift;
+                slot = OVERFLOW_SLOT;
+            } else {
+                current = to + 1;
+                return;
+            }
+            if (target > to + 1) {
+                current = to + 1;
+                return;
+            }
+            current = target;
+            cascade(slot);
+            continue;
+        }
+        
+        int64_t blockEnd = current | SLOT_MASK;
+        int64_t stop = to < blockEnd ? to : blockEnd;
+        int first = (int)(current & SLOT_MASK), last = (int)(stop & SLOT_MASK);
+        uint64_t due = occupied[0] & lowBits(last + 1) & ~lowBits(first);
+        while (due) {
+            int slot = lowestSetBit(due);
+            due &= due - 1;
+            takeSlot(slot, expired);
+        }
+        current = stop + 1;
+        if (stop < blockEnd) return;
+        
+        for (int l = 1; l < WHEEL_LEVELS; l++) {
+            int digit = (int)((current >> (WHEEL_BITS * l)) & SLOT_MASK);
+            cascade(l * WHEEL_SLOTS + digit);
+            if (digit != 0) break;
+            if (l == WHEEL_LEVELS - 1) cascade(OVERFLOW_SLOT);
+        }
+    }
+}
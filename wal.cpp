@@ -0,0 +1,195 @@
+#include "WriteAheadLog.h"
+#include <cstddef>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const size_t READ_BLOCK = 4096;     // frames per read
+
+// FNV-1a over every byte before the checksum field
+static uint32_t frameChecksum(const WalFrame& frame) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&frame);
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(WalFrame, checksum); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static bool syncFile(FILE* f) {
+    if (fflush(f) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+static bool truncateFile(const char* path, long length) {
+    FILE* f = fopen(path, "r+b");
+    if (!f) return false;
+#ifdef _WIN32
+    bool ok = _chsize(_fileno(f), length) == 0;
+#else
+    bool ok = ftruncate(fileno(f), length) == 0;
+#endif
+    ok = syncFile(f) && ok;
+    fclose(f);
+    return ok;
+}
+
+// ==================== WalReader ====================
+
+WalReader::WalReader() : in(nullptr), pos(0), count(0), lastSeq(0), validFrames(0) {}
+
+WalReader::~WalReader() {
+    if (in) fclose(in);
+}
+
+bool WalReader::open(const char* logPath) {
+    in = fopen(logPath, "rb");
+    if (!in) return false;
+    block.resize(READ_BLOCK);
+    return true;
+}
+
+bool WalReader::next(WalFrame& frame) {
+    if (!in) return false;
+    if (pos == count) {
+        count = fread(block.data(), sizeof(WalFrame), block.size(), in);
+        pos = 0;
+        if (count == 0) return false;
+    }
+    
+    const WalFrame& f = block[pos];
+    if (f.checksum != frameChecksum(f) || (validFrames > 0 && f.seq != lastSeq + 1)) {
+        count = pos;        // everything from here on is untrusted
+        fclose(in);
+        in = nullptr;
+        return false;
+    }
+    frame = f;
+    pos++;
+    lastSeq = f.seq;
+    validFrames++;
+    return true;
+}
+
+long WalReader::getValidFrames() { return validFrames; }
+uint64_t WalReader::getLastSequence() { return lastSeq; }
+
+// ==================== WriteAheadLog ====================
+
+WriteAheadLog::WriteAheadLog() : file(nullptr), groupFrames(64), nextSeq(1), durableSeq(0),
+                                 fileBytes(0) {}
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+bool WriteAheadLog::open(const char* logPath, uint64_t afterSeq, int group) {
+    close();
+    path = logPath;
+    groupFrames = group > 0 ? group : 1;
+    pending.reserve(groupFrames);
+    
+    // Find the last good frame and cut off anything after it
+    long validBytes = 0;
+    uint64_t lastSeq = 0;
+    FILE* existing = fopen(logPath, "rb");
+    if (existing) {
+        fseek(existing, 0, SEEK_END);
+        long size = ftell(existing);
+        fclose(existing);
+        
+        WalReader reader;
+        WalFrame frame;
+        if (reader.open(logPath)) {
+            while (reader.next(frame)) {}
+        }
+        validBytes = reader.getValidFrames() * (long)sizeof(WalFrame);
+        lastSeq = reader.getLastSequence();
+        if (size != validBytes && !truncateFile(logPath, validBytes)) return false;
+    }
+    
+    // Unbuffered, so a failed write leaves nothing behind to go out later
+    file = fopen(logPath, "ab");
+    if (!file) return false;
+    setvbuf(file, nullptr, _IONBF, 0);
+    fileBytes = validBytes;
+    durableSeq = lastSeq > afterSeq ? lastSeq : afterSeq;
+    nextSeq = durableSeq + 1;
+    return true;
+}
+
+void WriteAheadLog::close() {
+    if (!file) return;
+    commit();
+    if (file) fclose(file);         // a failed commit may have closed it
+    file = nullptr;
+}
+
+uint64_t WriteAheadLog::append(WalOp op, int a, int b, const char* text) {
+    if (!file) return 0;
+    
+    WalFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    if (text) {
+        size_t len = strlen(text);
+        if (len >= sizeof(frame.text)) return 0;
+        memcpy(frame.text, text, len);
+    }
+    frame.seq = nextSeq;
+    frame.op = (uint32_t)op;
+    frame.a = a;
+    frame.b = b;
+    frame.checksum = frameChecksum(frame);
+    
+    pending.push_back(frame);
+    nextSeq++;
+    if ((int)pending.size() >= groupFrames && !commit()) {
+        // The caller treats the operation as refused: so must the log
+        if (!pending.empty()) pending.pop_back();
+        nextSeq--;
+        return 0;
+    }
+    return frame.seq;
+}
+
+bool WriteAheadLog::commit() {
+    if (!file) return false;
+    if (pending.empty()) return true;
+    
+    if (fwrite(pending.data(), sizeof(WalFrame), pending.size(), file) != pending.size() ||
+        !syncFile(file)) {
+        // Part of the group may be on disk: cut it off, so trying again
+        // writes each frame once
+        clearerr(file);
+        if (!truncateFile(path.c_str(), fileBytes)) {
+            fclose(file);
+            file = nullptr;
+        }
+        return false;
+    }
+    fileBytes += (long)(pending.size() * sizeof(WalFrame));
+    durableSeq = pending.back().seq;
+    pending.clear();
+    return true;
+}
+
+bool WriteAheadLog::reset() {
+    if (!file || !commit()) return false;
+    fclose(file);
+    file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    setvbuf(file, nullptr, _IONBF, 0);
+    fileBytes = 0;
+    return syncFile(file);
+}
+
+uint64_t WriteAheadLog::getLastSequence() { return nextSeq - 1; }
+uint64_t WriteAheadLog::getDurableSequence() { return durableSeq; }
@@ -1,48 +1,170 @@
 #include "Zone.h"
 
-Zone::Zone() : zoneID(-1), name(""), areaCount(0), adjacentCount(0),
-               totalSlots(0), availableSlots(0) {}
+Zone::Zone() : zoneID(-1), name(""), areaCount(0), totalSlots(0), availableSlots(0),
+               attrsPresent(0) {
+    for (int c = 0; c < SLOT_CLASSES; c++) freeInClass[c] = 0;
+}
 
 void Zone::init(int id, std::string n, int numAreas, int* areaCapacities) {
     zoneID = id;
     name = n;
     areaCount = numAreas;
-    adjacentCount = 0;
+    adjacentZones.clear();
     totalSlots = 0;
     availableSlots = 0;
+    attrsPresent = 0;
+    for (int c = 0; c < SLOT_CLASSES; c++) freeInClass[c] = 0;
+    areas = std::vector<ParkingArea>(areaCount);
+    areaMask = std::vector<std::atomic<uint64_t>>(wordsFor(areaCount));
+    for (int w = 0; w < (int)areaMask.size(); w++) areaMask[w] = 0;
     
     for (int i = 0; i < areaCount; i++) {
         areas[i].init(i, zoneID, areaCapacities[i]);
         totalSlots += areaCapacities[i];
         availableSlots += areaCapacities[i];
+        syncAreaBit(i);
     }
 }
 
-void Zone::addAdjacent(int zID) {
-    if (adjacentCount < MAX_ZONES) {
-        adjacentZones[adjacentCount++] = zID;
+// Summary bits are only cleared after seeing the area full, and the area
+// is checked again afterwards, so a release racing with the clear can
+// never leave an area with free slots unmarked
+void Zone::syncAreaBit(int areaID) {
+    std::atomic<uint64_t>& word = areaMask[areaID / BITS_PER_WORD];
+    uint64_t bit = 1ULL << (areaID % BITS_PER_WORD);
+    if (!areas[areaID].hasSlots()) {
+        word.fetch_and(~bit);
+        if (!areas[areaID].hasSlots()) return;
     }
+    word.fetch_or(bit);
+}
+
+// Plain slots are counted by availableSlots alone, so a zone without
+// attributes pays nothing for them
+void Zone::countFree(int areaID, int slotID, int delta) {
+    if (attrsPresent == 0) return;
+    int attrs = areas[areaID].getSlotAttributes(slotID);
+    if (attrs) freeInClass[attrs] += delta;
+}
+
+bool Zone::setSlotAttributes(int areaID, int slotID, int attrs) {
+    if (areaID < 0 || areaID >= areaCount) return false;
+    ParkingArea& area = areas[areaID];
+    if (slotID < 0 || slotID >= area.getTotal()) return false;
+    int old = area.getSlotAttributes(slotID);
+    if (!area.setSlotAttributes(slotID, attrs)) return false;
+    if (area.getOccupant(slotID) == -1) {
+        if (old) freeInClass[old]--;
+        if (attrs) freeInClass[attrs]++;
+    }
+    attrsPresent = 0;
+    for (int i = 0; i < areaCount; i++) attrsPresent |= areas[i].getAttributesPresent();
+    return true;
+}
+
+int Zone::getSlotAttributes(int areaID, int slotID) {
+    return areas[areaID].getSlotAttributes(slotID);
+}
+
+int Zone::getAttributesPresent() { return attrsPresent; }
+
+int Zone::getAvailableFor(int needs) {
+    if (attrsPresent == 0) return (needs & SLOT_REQUIRED) ? 0 : availableSlots.load();
+    int plain = availableSlots, fit = 0;
+    for (int c = 1; c < SLOT_CLASSES; c++) {
+        int n = freeInClass[c];
+        plain -= n;
+        if (slotFits(c, needs)) fit += n;
+    }
+    return slotFits(0, needs) ? fit + plain : fit;
+}
+
+bool Zone::hasSlotsFor(int needs) {
+    return getAvailableFor(needs) > 0;
+}
+
+void Zone::addAdjacent(int zID) {
+    adjacentZones.push_back(zID);
 }
 
 bool Zone::hasSlots() { return availableSlots > 0; }
 
-ParkingSlot* Zone::findSlot() {
-    for (int i = 0; i < areaCount; i++) {
-        ParkingSlot* slot = areas[i].findSlot();
-        if (slot) return slot;
+// Areas with a free slot come straight from the summary words, so a
+// nearly full zone costs the same as an empty one
+ParkingSlot* Zone::findSlot(int needs) {
+    for (int w = 0; w < (int)areaMask.size(); w++) {
+        uint64_t word = areaMask[w].load();
+        while (word) {
+            ParkingSlot* slot = areas[w * BITS_PER_WORD + lowestSetBit(word)].findSlot(needs);
+            if (slot) return slot;
+            word &= word - 1;
+        }
     }
     return nullptr;
 }
 
 void Zone::occupySlot(ParkingSlot* slot, int vID) {
-    areas[slot->getAreaID()].occupySlot(slot->getSlotID(), vID);
+    occupySlot(slot->getAreaID(), slot->getSlotID(), vID);
+}
+
+bool Zone::occupySlot(int areaID, int slotID, int vID) {
+    if (areaID < 0 || areaID >= areaCount) return false;
+    if (!areas[areaID].occupySlot(slotID, vID)) return false;
     availableSlots--;
+    countFree(areaID, slotID, -1);
+    syncAreaBit(areaID);
+    return true;
+}
+
+// Walks the areas marked free and claims with the area's compare-and-swap,
+// so two gate threads can never be handed the same slot and no zone-wide
+// lock is held
+ParkingSlot* Zone::claimSlot(int vID, int needs) {
+    for (int w = 0; w < (int)areaMask.size(); w++) {
+        uint64_t word = areaMask[w].load();
+        while (word) {
+            int areaID = w * BITS_PER_WORD + lowestSetBit(word);
+            ParkingSlot* slot = areas[areaID].claimSlot(vID, needs);
+            if (slot) {
+                availableSlots--;
+                countFree(areaID, slot->getSlotID(), -1);
+                if (!areas[areaID].hasSlots()) syncAreaBit(areaID);
+                return slot;
+            }
+            if (!areas[areaID].hasSlots()) syncAreaBit(areaID);
+            word &= word - 1;
+        }
+    }
+    return nullptr;
+}
+
+// Bulk form of claimSlot(): each area hands over as many slots as it can
+// in one pass over its bitmap
+int Zone::claimSlots(int n, const int* vIDs, std::vector<ParkingSlot*>& out) {
+    int taken = 0;
+    for (int w = 0; w < (int)areaMask.size() && taken < n; w++) {
+        uint64_t word = areaMask[w].load();
+        while (word && taken < n) {
+            int areaID = w * BITS_PER_WORD + lowestSetBit(word);
+            int got = areas[areaID].claimSlots(n - taken, vIDs + taken, out);
+            for (int k = (int)out.size() - got; k < (int)out.size(); k++) {
+                countFree(areaID, out[k]->getSlotID(), -1);
+            }
+            taken += got;
+            syncAreaBit(areaID);
+            word &= word - 1;
+        }
+    }
+    availableSlots -= taken;
+    return taken;
 }
 
 bool Zone::releaseSlot(int areaID, int slotID) {
     if (areaID >= 0 && areaID < areaCount) {
         if (areas[areaID].releaseSlot(slotID)) {
             availableSlots++;
+            countFree(areaID, slotID, 1);
+            areaMask[areaID / BITS_PER_WORD].fetch_or(1ULL << (areaID % BITS_PER_WORD));
             return true;
         }
     }
@@ -53,8 +175,10 @@ int Zone::getID() { return zoneID; }
 std::string Zone::getName() { return name; }
 int Zone::getAvailable() { return availableSlots; }
 int Zone::getTotal() { return totalSlots; }
-int Zone::getAdjacentCount() { return adjacentCount; }
+int Zone::getAdjacentCount() { return (int)adjacentZones.size(); }
 int Zone::getAdjacent(int i) { return adjacentZones[i]; }
+int Zone::getAreaCount() { return areaCount; }
+ParkingArea& Zone::getArea(int i) { return areas[i]; }
 
 float Zone::getOccupancyRate() {
     if (totalSlots == 0) return 0;
@@ -66,11 +190,11 @@ void Zone::display() {
               << availableSlots << "/" << totalSlots << " slots available ("
               << std::fixed << std::setprecision(1) << getOccupancyRate() << "% occupied)\n";
     
-    if (adjacentCount > 0) {
+    if (getAdjacentCount() > 0) {
         std::cout << "  Adjacent Zones: ";
-        for (int i = 0; i < adjacentCount; i++) {
+        for (int i = 0; i < getAdjacentCount(); i++) {
             std::cout << adjacentZones[i];
-            if (i < adjacentCount - 1) std::cout << ", ";
+            if (i < getAdjacentCount() - 1) std::cout << ", ";
         }
         std::cout << "\n";
     }
@@ -81,16 +205,27 @@ void Zone::displayDetailed() {
     std::cout << "Total Capacity: " << totalSlots << " slots\n";
     std::cout << "Available: " << availableSlots << " slots\n";
     std::cout << "Occupancy Rate: " << std::fixed << std::setprecision(1) << getOccupancyRate() << "%\n";
+    if (attrsPresent) {
+        const char* names[SLOT_ATTRIBUTE_COUNT] = {"EV", "Accessible", "Compact", "Oversize"};
+        std::cout << "Special Slots Free:";
+        for (int a = 0; a < SLOT_ATTRIBUTE_COUNT; a++) {
+            if (!(attrsPresent & (1 << a))) continue;
+            int avail = 0;
+            for (int c = 1; c < SLOT_CLASSES; c++) if (c & (1 << a)) avail += freeInClass[c];
+            std::cout << " " << names[a] << " " << avail;
+        }
+        std::cout << "\n";
+    }
     std::cout << "\nAreas:\n";
     for (int i = 0; i < areaCount; i++) {
         areas[i].display();
     }
     
-    if (adjacentCount > 0) {
+    if (getAdjacentCount() > 0) {
         std::cout << "\nAdjacent Zones: ";
-        for (int i = 0; i < adjacentCount; i++) {
+        for (int i = 0; i < getAdjacentCount(); i++) {
             std::cout << adjacentZones[i];
-            if (i < adjacentCount - 1) std::cout << ", ";
+            if (i < getAdjacentCount() - 1) std::cout << ", ";
         }
         std::cout << "\n";
     }